@@ -0,0 +1,390 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+//
+// Kernel micro-benchmarks for the Laghost partial assembly kernels.
+//
+// For every registered (dim, D1D, Q1D) variant, a Cartesian mesh is generated,
+// the quadrature data is filled with synthetic values and each kernel is run
+// many times in isolation:
+//
+//    qdata  : QUpdate::UpdateQuadratureData (QKernel<DIM,Q1D>)
+//    force  : ForcePAOperator::Mult          (ForceMult2D/3D)
+//    forceT : ForcePAOperator::MultTranspose (ForceMultTranspose2D/3D)
+//    stress : StressPAOperator::MultTranspose(StressMultTranspose2D/3D)
+//    fa-asm : full assembly of the force matrix (ForceIntegrator)
+//    fa/faT : its sparse Mult and MultTranspose
+//    ea-asm : ForceEAOperator::Assemble
+//    ea/eaT : ForceEAOperator::Mult and MultTranspose
+//    retmap : Returnmapping2d/3d
+//
+// With -s the mesh has triangles or tetrahedra, the PA rows then run the
+// simplex kernels (ForceMultSimplex, ...) and the D1D/Q1D columns hold the
+// H1 dofs and the quadrature points per element.
+//
+// The reported GB/s and GFLOP/s use the minimal memory traffic and a
+// sum-factorization (or, on simplices, full basis table) flop count of each
+// kernel; both are estimates. The last column is the achieved fraction of the
+// roofline bound min(peak_gflops, AI * peak_bw) for the arithmetic intensity
+// AI.
+//
+// Sample runs:
+//    ./laghost-kernels
+//    ./laghost-kernels -dim 3 -o 2 -n 24 -r 50
+//    ./laghost-kernels -s -dim 2
+//    mpirun -np 4 ./laghost-kernels -bw 80 -pf 400
+
+#include "mfem.hpp"
+#include "../laghost_solver.hpp"
+#include "../laghost_rheology.hpp"
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace mfem;
+using namespace mfem::geodynamics;
+
+// Flops of one sum-factorized contraction chain from P to Q points per
+// direction in 'dim' dimensions (or back).
+static double TensorFlops(int dim, int P, int Q)
+{
+   double flops = 0.0;
+   for (int k = 1; k <= dim; k++)
+   {
+      flops += 2.0 * pow(P, dim - k + 1) * pow(Q, k);
+   }
+   return flops;
+}
+
+struct KernelCost
+{
+   double bytes, flops;
+};
+
+static void Report(const char *name, int dim, int D1D, int Q1D,
+                   const KernelCost &cost, double seconds, int reps,
+                   double peak_bw, double peak_flops, MPI_Comm comm)
+{
+   // The slowest rank sets the time, the cost is summed over all ranks.
+   double t, c[2] = {cost.bytes, cost.flops}, gc[2];
+   MPI_Allreduce(&seconds, &t, 1, MPI_DOUBLE, MPI_MAX, comm);
+   MPI_Allreduce(c, gc, 2, MPI_DOUBLE, MPI_SUM, comm);
+   int myid, nranks;
+   MPI_Comm_rank(comm, &myid);
+   MPI_Comm_size(comm, &nranks);
+   if (myid != 0) { return; }
+
+   const double t_rep = t / reps;
+   const double gbs = gc[0] / t_rep * 1e-9;
+   const double gfs = gc[1] / t_rep * 1e-9;
+   const double ai = gc[1] / gc[0];
+   const double bound = std::min(peak_flops, ai * peak_bw) * nranks;
+   cout << std::setw(8) << name
+        << std::setw(5) << dim << std::setw(5) << D1D << std::setw(5) << Q1D
+        << std::scientific << std::setprecision(3)
+        << std::setw(12) << t_rep
+        << std::fixed << std::setprecision(2)
+        << std::setw(10) << gbs << std::setw(10) << gfs
+        << std::setw(8) << ai
+        << std::setw(8) << 100.0 * gfs / bound << "%" << endl;
+}
+
+template <typename F>
+static double Time(int reps, F &&kernel)
+{
+   kernel(); // warm-up
+   MFEM_DEVICE_SYNC;
+   StopWatch sw;
+   sw.Start();
+   for (int r = 0; r < reps; r++) { kernel(); }
+   MFEM_DEVICE_SYNC;
+   sw.Stop();
+   return sw.RealTime();
+}
+
+static void RunVariant(ParMesh &pmesh, int order_v, int reps,
+                       double peak_bw, double peak_flops)
+{
+   const int dim = pmesh.Dimension();
+   const int order_e = order_v - 1;
+   MPI_Comm comm = pmesh.GetComm();
+
+   // High-order nodes owned by the mesh, in the layout of H1 below.
+   pmesh.SetCurvature(order_v, false, dim, Ordering::byNODES);
+
+   H1_FECollection H1FEC(order_v, dim);
+   L2_FECollection L2FEC(order_e, dim, BasisType::GaussLobatto);
+   ParFiniteElementSpace H1(&pmesh, &H1FEC, dim);
+   ParFiniteElementSpace L2(&pmesh, &L2FEC);
+   ParFiniteElementSpace L2_stress(&pmesh, &L2FEC, 3*(dim-1));
+
+   // Same integration rule as LagrangianGeoOperator.
+   const IntegrationRule &ir =
+      IntRules.Get(pmesh.GetElementBaseGeometry(0),
+                   3 * H1.GetOrder(0) + L2.GetOrder(0) - 1);
+   const int NE = pmesh.GetNE(), NQ = ir.GetNPoints();
+   const int Q1D = int(floor(0.7 + pow(NQ, 1.0 / dim)));
+   const int D1D = order_v + 1, L1D = order_e + 1;
+   const Geometry::Type geom = pmesh.GetElementBaseGeometry(0);
+   const int H1D = H1FEC.FiniteElementForGeometry(geom)->GetDof(),
+             L2D = L2FEC.FiniteElementForGeometry(geom)->GetDof();
+   const int nstress = 3*(dim-1);
+
+   // Basis evaluations between dofs and points, sum-factorized on quads and
+   // hexes, full tables on simplices.
+   const bool tensor = TensorMesh(pmesh);
+   const double h1_to_q = tensor ? TensorFlops(dim, D1D, Q1D) : 2.0*H1D*NQ,
+                q_to_h1 = tensor ? TensorFlops(dim, Q1D, D1D) : 2.0*H1D*NQ,
+                l2_to_q = tensor ? TensorFlops(dim, L1D, Q1D) : 2.0*L2D*NQ,
+                q_to_l2 = tensor ? TensorFlops(dim, Q1D, L1D) : 2.0*L2D*NQ;
+   const int P = tensor ? D1D : H1D, Q = tensor ? Q1D : NQ;
+
+   // Synthetic quadrature data: rest state with a smooth random stress.
+   QuadratureData qdata(dim, NE, NQ);
+   qdata.h0 = 1.0 / order_v;
+   qdata.dt_est = qdata.h_est = 1e38;
+   qdata.mscale = 1.0;
+   qdata.vbc_max_val = 1e-9;
+   qdata.gravity = 10.0;
+   qdata.rho0DetJ0w = 2700.0;
+   qdata.Jac0inv = 0.0;
+   for (int q = 0; q < NE*NQ; q++)
+   {
+      for (int d = 0; d < dim; d++) { qdata.Jac0inv(d, d, q) = 1.0; }
+   }
+   Vector sj(qdata.stressJinvT.Data(), qdata.stressJinvT.TotalSize());
+   Vector bj(qdata.buoyJinvT.Data(), qdata.buoyJinvT.TotalSize());
+   sj.Randomize(1); bj.Randomize(2);
+
+   // State vector (x, v, e, stress) in the layout of the solver.
+   const int h1s = H1.GetVSize(), l2s = L2.GetVSize();
+   Vector S(2*h1s + l2s + L2_stress.GetVSize());
+   Vector x(S, 0, h1s), v(S, h1s, h1s), e(S, 2*h1s, l2s),
+          sig(S, 2*h1s + l2s, L2_stress.GetVSize());
+   pmesh.GetNodes(x);
+   v.Randomize(3); v *= 1e-9;
+   e = 1.0;
+   sig.Randomize(4); sig *= 1e6;
+
+   ParGridFunction gamma_gf(&L2), lambda_gf(&L2), mu_gf(&L2);
+   gamma_gf = 1.4; lambda_gf = 3e10; mu_gf = 3e10;
+
+   TimingData timer(l2s);
+   QUpdate qupdate(dim, NE, Q1D, true, false, 0.5, &timer,
+                   gamma_gf, lambda_gf, mu_gf, ir, H1, L2, L2_stress);
+   ForcePAOperator force(qdata, H1, L2, ir);
+   StressPAOperator stress(qdata, H1, L2, ir);
+
+   Vector rhs(h1s), e_rhs(l2s);
+   const double d8 = sizeof(double);
+   const double q_tensor = (double) NE * NQ * dim * dim;
+   KernelCost cost;
+
+   // qdata: E-vector derivatives of x and v, values of e and stress, then
+   // the pointwise kernel writing three dim x dim tensors per point.
+   cost.bytes = d8 * (2.0*NE*H1D*dim + NE*L2D*(1 + nstress) +
+                      q_tensor * 3 + (double) NE*NQ*(dim*dim + 3));
+   cost.flops = NE * (2.0*dim*dim*h1_to_q + (1 + nstress) * l2_to_q +
+                      NQ * (dim == 2 ? 300.0 : 800.0));
+   Report("qdata", dim, P, Q, cost,
+          Time(reps, [&]() { qupdate.UpdateQuadratureData(S, qdata); }),
+          reps, peak_bw, peak_flops, comm);
+
+   // force: L2 values at points, contracted with stress and buoyancy, then
+   // the transposed gradient onto every H1 component.
+   cost.bytes = d8 * (2.0*q_tensor + NE*L2D + NE*H1D*dim);
+   cost.flops = NE * (l2_to_q + 4.0*NQ*dim*dim + dim*dim*q_to_h1);
+   Report("force", dim, P, Q, cost,
+          Time(reps, [&]() { force.Mult(e, rhs); }),
+          reps, peak_bw, peak_flops, comm);
+
+   // forceT: gradients of the H1 components at points, contracted with the
+   // stress, transposed onto L2.
+   cost.bytes = d8 * (q_tensor + NE*H1D*dim + NE*L2D);
+   cost.flops = NE * (dim*dim*h1_to_q + 2.0*NQ*dim*dim + q_to_l2);
+   Report("forceT", dim, P, Q, cost,
+          Time(reps, [&]() { force.MultTranspose(v, e_rhs); }),
+          reps, peak_bw, peak_flops, comm);
+
+   // stress: as forceT, for one stress component.
+   Report("stress", dim, P, Q, cost,
+          Time(reps, [&]() { stress.MultTranspose(v, e_rhs, 0); }),
+          reps, peak_bw, peak_flops, comm);
+
+   // fa-asm: element force matrices from the basis at every point, added to
+   // the sparse matrix, as in LagrangianGeoOperator::AssembleForceMatrix.
+   MixedBilinearForm Force(&L2, &H1);
+   ForceIntegrator *fi = new ForceIntegrator(qdata);
+   fi->SetIntRule(&ir);
+   Force.AddDomainIntegrator(fi);
+   Force.Assemble(0);
+   Force.Finalize(0);
+   const double elmat = (double) NE * H1D * dim * L2D;
+   cost.bytes = d8 * (q_tensor + elmat);
+   cost.flops = NE * NQ * (2.0*dim*dim*H1D + 2.0*H1D*dim*L2D);
+   Report("fa-asm", dim, P, Q, cost,
+          Time(reps, [&]() { Force = 0.0; Force.Assemble(); }),
+          reps, peak_bw, peak_flops, comm);
+
+   // fa/faT: CSR products, one value and one column index per nonzero.
+   const double nnz = Force.SpMat().NumNonZeroElems();
+   cost.bytes = nnz * (d8 + sizeof(int)) + d8 * (h1s + l2s);
+   cost.flops = 2.0 * nnz;
+   Report("fa", dim, P, Q, cost,
+          Time(reps, [&]() { Force.Mult(e, rhs); }),
+          reps, peak_bw, peak_flops, comm);
+   Report("faT", dim, P, Q, cost,
+          Time(reps, [&]() { Force.MultTranspose(v, e_rhs); }),
+          reps, peak_bw, peak_flops, comm);
+
+   // ea-asm, ea/eaT: the same element matrices, batched and applied element
+   // by element.
+   ForceEAOperator force_ea(qdata, H1, L2, ir);
+   cost.bytes = d8 * (q_tensor + elmat);
+   cost.flops = NE * NQ * (2.0*dim*dim*H1D + 2.0*H1D*dim*L2D);
+   Report("ea-asm", dim, P, Q, cost,
+          Time(reps, [&]() { force_ea.Assemble(); }),
+          reps, peak_bw, peak_flops, comm);
+   cost.bytes = d8 * (elmat + NE*L2D + NE*H1D*dim);
+   cost.flops = 2.0 * elmat;
+   Report("ea", dim, P, Q, cost,
+          Time(reps, [&]() { force_ea.Mult(e, rhs); }),
+          reps, peak_bw, peak_flops, comm);
+   Report("eaT", dim, P, Q, cost,
+          Time(reps, [&]() { force_ea.MultTranspose(v, e_rhs); }),
+          reps, peak_bw, peak_flops, comm);
+
+   // retmap: pointwise Mohr-Coulomb return mapping at every L2 dof of a
+   // two-material composition; stress and plastic strain are reset before
+   // every call so each repetition does the same (plastic) work.
+   const int nmat = 2;
+   Vector comp(l2s*nmat), s(l2s*nstress), s0(l2s*nstress), s_old(l2s*nstress),
+          pls(l2s), pls0(l2s), mat(l2s);
+   for (int i = 0; i < l2s; i++)
+   {
+      comp(i) = 0.75; comp(i + l2s) = 0.25; mat(i) = 0.0;
+   }
+   s0.Randomize(5); s0 *= 1e8; s_old = 0.0; pls0 = 0.0;
+   Vector rho(nmat), lambda(nmat), mu(nmat), tcut(nmat), coh0(nmat), coh1(nmat),
+          p0(nmat), p1(nmat), fri0(nmat), fri1(nmat), dil0(nmat), dil1(nmat),
+          pvisc(nmat);
+   rho = 2700.0; lambda = 3e10; mu = 3e10; tcut = 1e6; coh0 = 4e7; coh1 = 4e6;
+   p0 = 0.0; p1 = 0.5; fri0 = 30.0; fri1 = 5.0; dil0 = 0.0; dil1 = 0.0;
+   pvisc = 1e38;
+   int rdim = dim;
+   double h_min = qdata.h0, dt_old = 1.0;
+   bool viscoplastic = false;
+   double rm_time = 0.0;
+   StopWatch sw;
+   for (int r = 0; r <= reps; r++)
+   {
+      s = s0; pls = pls0;
+      sw.Clear(); sw.Start();
+      if (dim == 2)
+      {
+         Returnmapping2d(comp, s, s_old, pls, mat, rdim, h_min, rho, lambda, mu,
+                         tcut, coh0, coh1, p0, p1, fri0, fri1, dil0, dil1,
+                         pvisc, viscoplastic, dt_old);
+      }
+      else
+      {
+         Returnmapping3d(comp, s, s_old, pls, mat, rdim, h_min, rho, lambda, mu,
+                         tcut, coh0, coh1, p0, p1, fri0, fri1, dil0, dil1,
+                         pvisc, viscoplastic, dt_old);
+      }
+      sw.Stop();
+      if (r > 0) { rm_time += sw.RealTime(); } // skip the warm-up
+   }
+   cost.bytes = d8 * l2s * (nmat + 3.0*nstress + 2.0);
+   cost.flops = l2s * (nmat * 30.0 + 600.0); // mixing + 3x3 eigensolve
+   Report("retmap", dim, P, Q, cost, rm_time, reps,
+          peak_bw, peak_flops, comm);
+}
+
+int main(int argc, char *argv[])
+{
+   mfem::MPI_Session mpi(argc, argv);
+
+   int dim = 0;
+   int order = 0;
+   int n = 0;
+   int reps = 20;
+   bool simplex = false;
+   double peak_bw = 20.0;
+   double peak_flops = 50.0;
+   const char *device_config = "cpu";
+
+   OptionsParser args(argc, argv);
+   args.AddOption(&dim, "-dim", "--dimension",
+                  "Dimension to benchmark (0 = 2D and 3D).");
+   args.AddOption(&order, "-o", "--order",
+                  "Velocity order to benchmark (0 = all registered variants).");
+   args.AddOption(&n, "-n", "--elements",
+                  "Elements per direction (0 = 64 in 2D, 16 in 3D).");
+   args.AddOption(&reps, "-r", "--repetitions", "Timed repetitions per kernel.");
+   args.AddOption(&simplex, "-s", "--simplex", "-no-s", "--no-simplex",
+                  "Triangles/tetrahedra instead of quads/hexes.");
+   args.AddOption(&peak_bw, "-bw", "--peak-bandwidth",
+                  "Roofline memory bandwidth per rank [GB/s].");
+   args.AddOption(&peak_flops, "-pf", "--peak-gflops",
+                  "Roofline peak compute per rank [GFLOP/s].");
+   args.AddOption(&device_config, "-d", "--device",
+                  "Device configuration string, see Device::Configure().");
+   args.Parse();
+   if (!args.Good())
+   {
+      if (mpi.Root()) { args.PrintUsage(cout); }
+      return 1;
+   }
+   if (mpi.Root()) { args.PrintOptions(cout); }
+
+   Device backend;
+   backend.Configure(device_config);
+   if (mpi.Root()) { backend.Print(); }
+
+   // Registered kernel variants: D1D = order+1, Q1D = 2*order. The simplex
+   // kernels take any order and run over the same range.
+   const int max_order[4] = {0, 0, 8, 4};
+
+   if (mpi.Root())
+   {
+      cout << std::setw(8) << "kernel" << std::setw(5) << "dim"
+           << std::setw(5) << "D1D" << std::setw(5) << "Q1D"
+           << std::setw(12) << "s/call" << std::setw(10) << "GB/s"
+           << std::setw(10) << "GFLOP/s" << std::setw(8) << "AI"
+           << std::setw(9) << "roof" << endl;
+   }
+
+   for (int d = 2; d <= 3; d++)
+   {
+      if (dim && d != dim) { continue; }
+      const int ne = n ? n : (d == 2 ? 64 : 16);
+      Mesh mesh = (d == 2) ?
+                  Mesh::MakeCartesian2D(ne, ne, simplex ? Element::TRIANGLE :
+                                        Element::QUADRILATERAL) :
+                  Mesh::MakeCartesian3D(ne, ne, ne, simplex ?
+                                        Element::TETRAHEDRON :
+                                        Element::HEXAHEDRON);
+      ParMesh pmesh(MPI_COMM_WORLD, mesh);
+      mesh.Clear();
+
+      for (int o = 2; o <= max_order[d]; o++)
+      {
+         if (order && o != order) { continue; }
+         RunVariant(pmesh, o, reps, peak_bw, peak_flops);
+      }
+   }
+   return 0;
+}
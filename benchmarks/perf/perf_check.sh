@@ -0,0 +1,107 @@
+#!/usr/bin/env bash
+#
+# Performance regression check for Laghost.
+#
+# Runs the small, fixed step count versions of the elastic column, plastic
+# oedometer and viscoplastic simple shear benchmarks, collects per-phase
+# timings, CG iteration counts and memory from the laghost output, and compares
+# them against a baseline file.
+#
+#   perf_check.sh             compare against the baseline, exit 1 on regression
+#   perf_check.sh --baseline  (re)write the baseline from the current build
+#
+# Environment:
+#   LAGHOST         laghost executable            (default ./laghost)
+#   MPIEXEC, NP     MPI launcher and rank count   (default mpirun, 1)
+#   MPIEXEC_NP      launcher rank-count flag      (default -np)
+#   PERF_BASELINE   baseline file                 (default PERF_BASELINE.dat)
+#   PERF_RESULTS    results of the current run    (default PERF_RESULTS.dat)
+#   PERF_TOL        allowed slowdown factor on timings           (default 1.25)
+#   PERF_MEM_TOL    allowed growth factor on memory              (default 1.25)
+#   PERF_ITER_TOL   allowed growth factor on CG iteration counts (default 1.0)
+#   PERF_MIN_TIME   timings below this (seconds) are not checked (default 0.05)
+#
+# The iteration counts are deterministic for a given build and rank count, so
+# by default any increase is reported as a regression.
+
+LAGHOST=${LAGHOST:-./laghost}
+MPIEXEC=${MPIEXEC:-mpirun}
+NP=${NP:-1}
+MPIEXEC_NP=${MPIEXEC_NP:--np}
+PERF_BASELINE=${PERF_BASELINE:-PERF_BASELINE.dat}
+PERF_RESULTS=${PERF_RESULTS:-PERF_RESULTS.dat}
+PERF_TOL=${PERF_TOL:-1.25}
+PERF_MEM_TOL=${PERF_MEM_TOL:-1.25}
+PERF_ITER_TOL=${PERF_ITER_TOL:-1.0}
+PERF_MIN_TIME=${PERF_MIN_TIME:-0.05}
+
+CASE_DIR=$(dirname "$0")
+CASES="elastic_column plastic_oedometer_test viscoplastic_simple_shear_test"
+
+write_baseline=0
+if [ "$1" = "--baseline" ]; then write_baseline=1; fi
+
+# Extract "case metric value" lines from one laghost run log.
+extract()
+{
+   awk -v c="$1" '
+      /^CG \(H1\) total time:/          { print c, "time_cg_h1",   $NF }
+      /^CG \(L2\) total time:/          { print c, "time_cg_l2",   $NF }
+      /^Forces total time:/             { print c, "time_force",   $NF }
+      /^UpdateQuadData total time:/     { print c, "time_qdata",   $NF }
+      /^Time loop total time:/          { print c, "time_loop",    $NF }
+      /^CG \(H1\) iterations:/          { print c, "iter_cg_h1",   $NF }
+      /^CG \(L2\) iterations:/          { print c, "iter_cg_l2",   $NF }
+      /^Maximum memory resident set size:/ {
+         split($(NF-1), m, "/"); print c, "mem_max_mb", m[1] }
+   ' "$2"
+}
+
+rm -f "$PERF_RESULTS"
+for c in $CASES; do
+   log=PERF_RUN_$c.dat
+   echo "perf: running $c"
+   if ! $MPIEXEC $MPIEXEC_NP "$NP" "$LAGHOST" -i "$CASE_DIR/$c.cfg" > "$log" 2>&1; then
+      echo "perf: $c failed, see $log"
+      exit 1
+   fi
+   extract "$c" "$log" >> "$PERF_RESULTS"
+   # Every case sets sim.mem_usage; without the memory line the case file was
+   # not the one that ran.
+   if ! grep -q "^$c mem_max_mb " "$PERF_RESULTS"; then
+      echo "perf: $c reported no memory usage, was $CASE_DIR/$c.cfg read? see $log"
+      exit 1
+   fi
+done
+
+if [ $write_baseline -eq 1 ]; then
+   cp "$PERF_RESULTS" "$PERF_BASELINE"
+   echo "perf: baseline written to $PERF_BASELINE"
+   exit 0
+fi
+
+if [ ! -f "$PERF_BASELINE" ]; then
+   echo "perf: no baseline $PERF_BASELINE, run with --baseline first"
+   exit 1
+fi
+
+awk -v tol="$PERF_TOL" -v mtol="$PERF_MEM_TOL" -v itol="$PERF_ITER_TOL" \
+    -v tmin="$PERF_MIN_TIME" '
+   NR == FNR { base[$1 " " $2] = $3; next }
+   {
+      key = $1 " " $2
+      if (!(key in base)) { printf("  new   %-45s %12g\n", key, $3); next }
+      b = base[key]; v = $3; f = tol
+      if ($2 ~ /^iter_/) { f = itol }
+      if ($2 ~ /^mem_/)  { f = mtol }
+      bad = (v > f * b)
+      if ($2 ~ /^time_/ && b < tmin && v < tmin) { bad = 0 }
+      printf("  %-5s %-45s %12g  (baseline %g, x%.2f)\n",
+             bad ? "FAIL" : "ok", key, v, b, (b > 0) ? v / b : 0)
+      if (bad) { nfail++ }
+   }
+   END {
+      if (nfail) { printf("perf: %d regression(s) detected\n", nfail); exit 1 }
+      print "perf: no regressions"
+   }
+' "$PERF_BASELINE" "$PERF_RESULTS"
@@ -153,7 +153,7 @@ void HeatDistanceSolver::ComputeScalarDistance(Coefficient &zero_level_set,
    int amg_print_level = 0;
 
    // Solver.
-   CGSolver cg(MPI_COMM_WORLD);
+   CGSolver cg(pfes.GetComm());
    cg.SetRelTol(1e-12);
    cg.SetMaxIter(100);
    cg.SetPrintLevel(print_level);
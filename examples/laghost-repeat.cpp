@@ -0,0 +1,116 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+//
+// Repeated Laghost runs on one mesh through the Simulation API.
+//
+// The model of the input file is set up once. Each sample then resets it with
+// a different friction angle (the same for all materials), runs it to
+// sim.t_final or for sim.max_tsteps steps, and reports the maximum plastic
+// strain. The mesh, the finite element spaces and the operators are built
+// only once, which is the pattern of a parameter sweep or of an inverse
+// modelling loop.
+//
+// Sample runs:
+//    ./laghost-repeat -i ../defaults.cfg
+//    mpirun -np 4 ./laghost-repeat -i ../defaults.cfg -s 8 -fa0 10 -fa1 40
+
+#include "mfem.hpp"
+#include "../laghost_simulation.hpp"
+#include "../input.hpp"
+#include <climits>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace mfem;
+
+int main(int argc, char *argv[])
+{
+   mfem::MPI_Session mpi(argc, argv);
+
+   const char *input_parameter_file = "../defaults.cfg";
+   int samples = 4;
+   double fa0 = 15.0, fa1 = 35.0;
+   const char *device_config = "cpu";
+
+   OptionsParser args(argc, argv);
+   args.AddOption(&input_parameter_file, "-i", "--input",
+                  "Input parameter file to use.");
+   args.AddOption(&samples, "-s", "--samples", "Number of runs.");
+   args.AddOption(&fa0, "-fa0", "--friction-angle-min",
+                  "Friction angle of the first run [deg].");
+   args.AddOption(&fa1, "-fa1", "--friction-angle-max",
+                  "Friction angle of the last run [deg].");
+   args.AddOption(&device_config, "-d", "--device",
+                  "Device configuration string, see Device::Configure().");
+   args.Parse();
+   if (!args.Good())
+   {
+      if (mpi.Root()) { args.PrintUsage(cout); }
+      return 1;
+   }
+   if (mpi.Root()) { args.PrintOptions(cout); }
+
+   Device backend;
+   backend.Configure(device_config);
+   if (mpi.Root()) { backend.Print(); }
+
+   Param param;
+   get_input_parameters(input_parameter_file, param);
+   const int max_steps =
+      param.sim.max_tsteps > -1 ? param.sim.max_tsteps : INT_MAX;
+
+   StopWatch sw;
+   sw.Start();
+   Simulation sim(MPI_COMM_WORLD);
+   sim.Setup(param);
+   sw.Stop();
+   if (mpi.Root())
+   {
+      cout << "Setup: " << sw.RealTime() << " s" << endl;
+      cout << setw(8) << "sample" << setw(12) << "friction"
+           << setw(10) << "steps" << setw(14) << "time"
+           << setw(14) << "max pls" << setw(12) << "run [s]" << endl;
+   }
+
+   for (int s = 0; s < samples; s++)
+   {
+      const double fa = (samples > 1) ? fa0 + (fa1 - fa0) * s / (samples - 1)
+                                      : fa0;
+      param.mat.friction_angle0 = std::to_string(fa);
+      param.mat.friction_angle1 = std::to_string(fa);
+
+      sw.Clear();
+      sw.Start();
+      sim.Reset(param);
+      sim.Advance(max_steps);
+      sw.Stop();
+
+      const double pls = sim.PlasticStrain().Normlinf();
+      double pls_max;
+      MPI_Reduce(&pls, &pls_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+      if (mpi.Root())
+      {
+         cout << setw(8) << s << setw(12) << fa << setw(10) << sim.Steps()
+              << scientific << setprecision(4)
+              << setw(14) << sim.Time() << setw(14) << pls_max
+              << fixed << setprecision(3) << setw(12) << sw.RealTime()
+              << endl;
+      }
+   }
+   return 0;
+}
@@ -64,6 +64,28 @@ static void declare_parameters(po::options_description &cfg,
          "Enable figure of merit output.")
         ("sim.gpu_aware_mpi", po::value<bool>(&p.sim.gpu_aware_mpi)->default_value(false),
          "Enable GPU aware MPI communications.")
+        ("sim.surface_output", po::value<bool>(&p.sim.surface_output)->default_value(false),
+         "Append top/bottom boundary nodes and diagnostics to <basename>_surface.bin")
+        ("sim.surface_steps", po::value<int>(&p.sim.surface_steps)->default_value(1),
+         "Write a surface time series record every n steps.")
+        ("sim.log_energy", po::value<bool>(&p.sim.log_energy)->default_value(false),
+         "Print internal and kinetic energy on log lines.")
+        ("sim.output_float32", po::value<bool>(&p.sim.output_float32)->default_value(false),
+         "Write ParaView fields in single precision (VisIt output is unchanged).")
+        ("sim.output_lod", po::value<int>(&p.sim.output_lod)->default_value(0),
+         "Levels of detail of the ParaView output, a display hint for VisIt (0 = as before: velocity order for ParaView, VisIt default).")
+        ("sim.output_field_every", po::value<std::string>(&p.sim.output_field_every)->default_value(""),
+         "Per-field output cadence, e.g. \"Stress:4,Composition:10\" (in output events).")
+        ("sim.imbalance_report", po::value<bool>(&p.sim.imbalance_report)->default_value(false),
+         "Report per-rank time and end-of-phase barrier wait per phase at the end of the run.")
+        ("sim.imbalance_csv", po::value<std::string>(&p.sim.imbalance_csv)->default_value(""),
+         "Optional CSV file for the per-rank load-balance data.")
+        ("sim.omp_threads", po::value<int>(&p.sim.omp_threads)->default_value(0),
+         "OpenMP threads per rank for the omp device (0: OpenMP default).")
+        ("sim.sync_report", po::value<bool>(&p.sim.sync_report)->default_value(false),
+         "Report host/device synchronisation points at the end of the run.")
+        ("sim.ensemble", po::value<std::string>(&p.sim.ensemble)->default_value(""),
+         "File with one line of ';'-separated option overrides per ensemble member (empty: single run).")
         ;
 
     cfg.add_options()
@@ -73,7 +95,19 @@ static void declare_parameters(po::options_description &cfg,
         ("solver.ftz_tol", po::value<double>(&p.solver.ftz_tol)->default_value(0.0)," ")
         ("solver.cg_max_iter", po::value<int>(&p.solver.cg_max_iter)->default_value(300)," ")
         ("solver.p_assembly", po::value<bool>(&p.solver.p_assembly)->default_value(false)," ")
+        ("solver.force_ea", po::value<bool>(&p.solver.force_ea)->default_value(true),
+         "Full assembly: apply the force operator from element matrices instead of a sparse matrix.")
         ("solver.impose_visc", po::value<bool>(&p.solver.impose_visc)->default_value(true)," ")
+        ("solver.dt_safety", po::value<double>(&p.solver.dt_safety)->default_value(0.8),
+         "Time step as a fraction of the stable time step estimate")
+        ("solver.dt_growth", po::value<double>(&p.solver.dt_growth)->default_value(1.02),
+         "Largest growth factor of the time step between two steps")
+        ("solver.dt_retry_factor", po::value<double>(&p.solver.dt_retry_factor)->default_value(0.5),
+         "Time step reduction when a step inverts an element")
+        ("solver.dt_max_retries", po::value<int>(&p.solver.dt_max_retries)->default_value(5),
+         "Retries of a step that inverts an element before aborting")
+        ("solver.dt_log", po::value<bool>(&p.solver.dt_log)->default_value(false),
+         "Print the time step and its limiter at every step")
         ;
 
     cfg.add_options()
@@ -82,6 +116,7 @@ static void declare_parameters(po::options_description &cfg,
         ("bc.bc_vxs", po::value<std::string>(&p.bc.bc_vxs)->default_value("[0]"), "Boundary veloicty x '[d0, d1, d2, ...]")
         ("bc.bc_vys", po::value<std::string>(&p.bc.bc_vys)->default_value("[0]"), "Boundary velocity y '[d0, d1, d2, ...]")
         ("bc.bc_vzs", po::value<std::string>(&p.bc.bc_vzs)->default_value("[0]"), "Boundary velocity z '[d0, d1, d2, ...]")
+        ("bc.bc_ramp_time", po::value<double>(&p.bc.bc_ramp_time)->default_value(0.0), "Time over which the boundary velocities ramp up linearly from zero (0: no ramp)")
         ;
 
     cfg.add_options()
@@ -99,6 +134,12 @@ static void declare_parameters(po::options_description &cfg,
         ("control.mass_bal", po::value<bool>(&p.control.mass_bal)->default_value(false)," ")
         ("control.dyn_damping", po::value<bool>(&p.control.dyn_damping)->default_value(true)," ")
         ("control.dyn_factor", po::value<double>(&p.control.dyn_factor)->default_value(0.8), " ")
+        ("control.selective_mscale", po::value<bool>(&p.control.selective_mscale)->default_value(false),
+         "Scale the inertia of elements smaller than control.smscale_h so that their stable time step is the one of an element of that size")
+        ("control.smscale_h", po::value<double>(&p.control.smscale_h)->default_value(0.0),
+         "Target element size of the selective mass scaling [m] (0: mean element size)")
+        ("control.smscale_max_added", po::value<double>(&p.control.smscale_max_added)->default_value(0.05),
+         "Largest mass added by the selective mass scaling, as a fraction of the total mass; the target size is lowered to respect it")
         ("control.surf_proc", po::value<bool>(&p.control.surf_proc)->default_value(true)," ")
         ("control.surf_diff", po::value<double>(&p.control.surf_diff)->default_value(1.0e-7), " ")
         ("control.bott_proc", po::value<bool>(&p.control.bott_proc)->default_value(true)," ")
@@ -175,6 +216,10 @@ static void declare_parameters(po::options_description &cfg,
         ("tmop.barrier_type", po::value<int>(&p.tmop. barrier_type)->default_value(0), " ")
         ("tmop.worst_case_type", po::value<int>(&p.tmop.worst_case_type)->default_value(0), " ")
         ("tmop.tmop_cond_num", po::value<double>(&p.tmop.tmop_cond_num)->default_value(0.5), " ")
+        ("tmop.shear_pls", po::value<double>(&p.tmop.shear_pls)->default_value(0.1), "Plastic strain marking shear zones for target_id 12")
+        ("tmop.shear_width", po::value<double>(&p.tmop.shear_width)->default_value(0.0), "Distance over which the target size grows away from shear zones, 0 for four mean element sizes")
+        ("tmop.shear_size_ratio", po::value<double>(&p.tmop.shear_size_ratio)->default_value(10.0), "Target element volume away from shear zones over the one inside them")
+        ("tmop.remap_product", po::value<bool>(&p.tmop.remap_product)->default_value(false), "Remap every L2 field as a product with one transported volume field")
         ;
 }
 
@@ -216,6 +261,30 @@ void get_input_parameters(const char* filename, Param& p)
 }
 
 
+void get_input_parameters(const char* filename, Param& p,
+                          const std::vector<std::string> &overrides)
+{
+    po::options_description cfg("Config file options");
+    po::variables_map vm;
+
+    declare_parameters(cfg, p);
+    // The overrides are stored first, so that they take precedence over the
+    // values in the file.
+    std::ostringstream lines;
+    for (const auto &o : overrides) { lines << o << '\n'; }
+    std::istringstream is(lines.str());
+    try {
+        po::store(po::parse_config_file(is, cfg), vm);
+    }
+    catch (std::exception& e) {
+        std::cerr << "Error in the option overrides '" << lines.str() << "'\n";
+        std::cerr << e.what() << "\n";
+        std::exit(1);
+    }
+    read_parameters_from_file(filename, cfg, vm);
+}
+
+
 
 #if 0
 template<class T>
@@ -2,5 +2,6 @@
 #define LAGHOST_INPUT_HPP
 
 void get_input_parameters(const char*, Param&);
+void get_input_parameters(const char*, Param&, const std::vector<std::string>&);
 
 #endif
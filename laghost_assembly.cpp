@@ -221,6 +221,117 @@ void ForceIntegrator::AssembleElementMatrix2(const FiniteElement &trial_fe,
    }
 }
 
+ForceEAOperator::ForceEAOperator(const QuadratureData &qdata,
+                                 ParFiniteElementSpace &h1,
+                                 ParFiniteElementSpace &l2,
+                                 const IntegrationRule &ir) :
+   Operator(h1.GetVSize(), l2.GetVSize()),
+   dim(h1.GetMesh()->Dimension()),
+   NQ(ir.GetNPoints()),
+   NE(h1.GetMesh()->GetNE()),
+   ND(h1.GetFE(0)->GetDof()),
+   NL(l2.GetFE(0)->GetDof()),
+   qdata(qdata),
+   H1(h1),
+   L2(l2),
+   H1D2Q(&h1.GetFE(0)->GetDofToQuad(ir, DofToQuad::FULL)),
+   L2D2Q(&l2.GetFE(0)->GetDofToQuad(ir, DofToQuad::FULL)) { }
+
+void ForceEAOperator::Assemble()
+{
+   // The mesh may have changed since the last assembly (AMR).
+   NE = H1.GetMesh()->GetNE();
+   height = H1.GetVSize();
+   width = L2.GetVSize();
+   elmats.SetSize(ND*dim*NL*NE);
+   X.SetSize(NL*NE);
+   Y.SetSize(ND*dim*NE);
+
+   const int DIM = dim, nq = NQ, nd = ND, nl = NL, ne = NE;
+   // DofToQuad::FULL tables: B is nq x dofs, G is nq x dim x dofs.
+   auto B = Reshape(L2D2Q->B.Read(), nq, nl);
+   auto G = Reshape(H1D2Q->G.Read(), nq, DIM, nd);
+   const double *StressJinvT = Read(qdata.stressJinvT.GetMemory(),
+                                    nq*ne*DIM*DIM);
+   auto sJit = Reshape(StressJinvT, nq*ne, DIM, DIM);
+   auto M = Reshape(elmats.Write(), nd, DIM, nl, ne);
+   MFEM_FORALL(e, ne,
+   {
+      for (int j = 0; j < nl; j++)
+      {
+         for (int vd = 0; vd < DIM; vd++)
+         {
+            for (int i = 0; i < nd; i++) { M(i, vd, j, e) = 0.0; }
+         }
+      }
+      for (int q = 0; q < nq; q++)
+      {
+         const int eq = e*nq + q;
+         for (int vd = 0; vd < DIM; vd++)
+         {
+            for (int i = 0; i < nd; i++)
+            {
+               // stress:grad_shape at the current point.
+               double f = 0.0;
+               for (int gd = 0; gd < DIM; gd++)
+               {
+                  f += sJit(eq, gd, vd) * G(q, gd, i);
+               }
+               for (int j = 0; j < nl; j++) { M(i, vd, j, e) += f * B(q, j); }
+            }
+         }
+      }
+   });
+}
+
+void ForceEAOperator::Mult(const Vector &x, Vector &y) const
+{
+   const Operator *H1R = H1.GetElementRestriction(ElementDofOrdering::NATIVE);
+   const Operator *L2R = L2.GetElementRestriction(ElementDofOrdering::NATIVE);
+   L2R->Mult(x, X);
+   const int DIM = dim, nd = ND, nl = NL;
+   auto M = Reshape(elmats.Read(), nd, DIM, nl, NE);
+   auto xe = Reshape(X.Read(), nl, NE);
+   auto ye = Reshape(Y.Write(), nd, DIM, NE);
+   MFEM_FORALL(e, NE,
+   {
+      for (int vd = 0; vd < DIM; vd++)
+      {
+         for (int i = 0; i < nd; i++)
+         {
+            double s = 0.0;
+            for (int j = 0; j < nl; j++) { s += M(i, vd, j, e) * xe(j, e); }
+            ye(i, vd, e) = s;
+         }
+      }
+   });
+   H1R->MultTranspose(Y, y);
+}
+
+void ForceEAOperator::MultTranspose(const Vector &x, Vector &y) const
+{
+   const Operator *H1R = H1.GetElementRestriction(ElementDofOrdering::NATIVE);
+   const Operator *L2R = L2.GetElementRestriction(ElementDofOrdering::NATIVE);
+   H1R->Mult(x, Y);
+   const int DIM = dim, nd = ND, nl = NL;
+   auto M = Reshape(elmats.Read(), nd, DIM, nl, NE);
+   auto xe = Reshape(Y.Read(), nd, DIM, NE);
+   auto ye = Reshape(X.Write(), nl, NE);
+   MFEM_FORALL(e, NE,
+   {
+      for (int j = 0; j < nl; j++)
+      {
+         double s = 0.0;
+         for (int vd = 0; vd < DIM; vd++)
+         {
+            for (int i = 0; i < nd; i++) { s += M(i, vd, j, e) * xe(i, vd, e); }
+         }
+         ye(j, e) = s;
+      }
+   });
+   L2R->MultTranspose(X, y);
+}
+
 void BodyForceIntegrator::AssembleRHSElementVect(const FiniteElement &fe,
                                                ElementTransformation &Tr,
                                                Vector &elvect)
@@ -295,12 +406,23 @@ MassPAOperator::MassPAOperator(ParFiniteElementSpace &pfes,
    ess_tdofs_count(0),
    ess_tdofs(0)
 {
-   pabf.SetAssemblyLevel(AssemblyLevel::PARTIAL);
+   // The partially assembled mass integrator needs tensor elements; on
+   // simplices a sparse matrix is assembled instead, again in Reassemble()
+   // whenever the mesh nodes move.
+   pabf.SetAssemblyLevel(TensorMesh(*pfes.GetMesh()) ? AssemblyLevel::PARTIAL
+                                                     : AssemblyLevel::LEGACY);
    pabf.AddDomainIntegrator(new mfem::MassIntegrator(Q, &ir));
    pabf.Assemble();
    pabf.FormSystemMatrix(mfem::Array<int>(), mass);
 }
 
+void MassPAOperator::Reassemble()
+{
+   pabf.Update();
+   pabf.Assemble();
+   pabf.FormSystemMatrix(mfem::Array<int>(), mass);
+}
+
 void MassPAOperator::SetEssentialTrueDofs(Array<int> &dofs)
 {
    ess_tdofs_count = dofs.Size();
@@ -334,6 +456,7 @@ StressPAOperator::StressPAOperator(const QuadratureData &qdata,
    Operator(),
    dim(h1.GetMesh()->Dimension()),
    NE(h1.GetMesh()->GetNE()),
+   tensor(TensorMesh(*h1.GetMesh())),
    qdata(qdata),
    H1(h1),
    L2(l2),
@@ -343,10 +466,13 @@ StressPAOperator::StressPAOperator(const QuadratureData &qdata,
    D1D(H1.GetFE(0)->GetOrder()+1),
    Q1D(ir1D.GetNPoints()),
    L1D(L2.GetFE(0)->GetOrder()+1),
+   NQ(ir.GetNPoints()),
    H1sz(H1.GetVDim() * H1.GetFE(0)->GetDof() * NE),
    L2sz(L2.GetFE(0)->GetDof() * NE),
-   L2D2Q(&L2.GetFE(0)->GetDofToQuad(ir, DofToQuad::TENSOR)),
-   H1D2Q(&H1.GetFE(0)->GetDofToQuad(ir, DofToQuad::TENSOR)),
+   L2D2Q(&L2.GetFE(0)->GetDofToQuad(ir, tensor ? DofToQuad::TENSOR :
+                                    DofToQuad::FULL)),
+   H1D2Q(&H1.GetFE(0)->GetDofToQuad(ir, tensor ? DofToQuad::TENSOR :
+                                    DofToQuad::FULL)),
    X(L2sz), Y(H1sz) { }
 
 void StressPAOperator::Mult(const Vector &x, Vector &y) const
@@ -785,12 +911,51 @@ static void StressMultTranspose(const int DIM, const int D1D, const int Q1D,
    call[id](NE, L2Bt, H1B, H1G, stressJinvT, v, e, comp);
 }
 
+// Simplex version of StressMultTranspose with the DofToQuad::FULL tables:
+// the comp component of tauJinvT projected on the L2 basis,
+// e(l) = sum_q B(q,l) tau(q).
+template<int DIM> static
+void StressMultTransposeSimplex(const int NE, const int NQ,
+                                const Array<double> &B_,
+                                const DenseTensor &sJit_,
+                                Vector &y, const int &comp)
+{
+   const int NL = B_.Size() / NQ;
+   // Stress component comp as (row, column) of tauJinvT.
+   const int ci[6] = {0, 1, DIM == 2 ? 1 : 2, 0, 0, 1};
+   const int cj[6] = {0, 1, DIM == 2 ? 0 : 2, 1, 2, 2};
+   const int i = ci[comp], j = cj[comp];
+   auto b = Reshape(B_.Read(), NQ, NL);
+   const double *StressJinvT = Read(sJit_.GetMemory(), NQ*NE*DIM*DIM);
+   auto sJit = Reshape(StressJinvT, NQ, NE, DIM, DIM);
+   auto energy = Reshape(y.Write(), NL, NE);
+   MFEM_FORALL(e, NE,
+   {
+      for (int l = 0; l < NL; ++l)
+      {
+         double u = 0.0;
+         for (int q = 0; q < NQ; ++q) { u += b(q,l) * sJit(q,e,i,j); }
+         energy(l,e) = u;
+      }
+   });
+}
+
 void StressPAOperator::MultTranspose(const Vector &x, Vector &y, const int &comp) const
 {
    H1R->Mult(x, Y);
-   StressMultTranspose(dim, D1D, Q1D, L1D, NE,
-                      L2D2Q->Bt, H1D2Q->B, H1D2Q->G,
-                      qdata.tauJinvT, Y, X, comp);
+   if (!tensor)
+   {
+      if (dim == 2)
+      { StressMultTransposeSimplex<2>(NE, NQ, L2D2Q->B, qdata.tauJinvT, X, comp); }
+      else
+      { StressMultTransposeSimplex<3>(NE, NQ, L2D2Q->B, qdata.tauJinvT, X, comp); }
+   }
+   else
+   {
+      StressMultTranspose(dim, D1D, Q1D, L1D, NE,
+                          L2D2Q->Bt, H1D2Q->B, H1D2Q->G,
+                          qdata.tauJinvT, Y, X, comp);
+   }
    if (L2R) { L2R->MultTranspose(X, y); }
    else { y = X; }
 }
@@ -802,6 +967,7 @@ ForcePAOperator::ForcePAOperator(const QuadratureData &qdata,
    Operator(),
    dim(h1.GetMesh()->Dimension()),
    NE(h1.GetMesh()->GetNE()),
+   tensor(TensorMesh(*h1.GetMesh())),
    qdata(qdata),
    H1(h1),
    L2(l2),
@@ -811,10 +977,13 @@ ForcePAOperator::ForcePAOperator(const QuadratureData &qdata,
    D1D(H1.GetFE(0)->GetOrder()+1),
    Q1D(ir1D.GetNPoints()),
    L1D(L2.GetFE(0)->GetOrder()+1),
+   NQ(ir.GetNPoints()),
    H1sz(H1.GetVDim() * H1.GetFE(0)->GetDof() * NE),
    L2sz(L2.GetFE(0)->GetDof() * NE),
-   L2D2Q(&L2.GetFE(0)->GetDofToQuad(ir, DofToQuad::TENSOR)),
-   H1D2Q(&H1.GetFE(0)->GetDofToQuad(ir, DofToQuad::TENSOR)),
+   L2D2Q(&L2.GetFE(0)->GetDofToQuad(ir, tensor ? DofToQuad::TENSOR :
+                                    DofToQuad::FULL)),
+   H1D2Q(&H1.GetFE(0)->GetDofToQuad(ir, tensor ? DofToQuad::TENSOR :
+                                    DofToQuad::FULL)),
    X(L2sz), Y(H1sz) { }
 
 template<int DIM, int D1D, int Q1D, int L1D, int NBZ = 1> static
@@ -1243,13 +1412,76 @@ static void ForceMult(const int DIM, const int D1D, const int Q1D,
    call[id](NE, B, Bt, Gt, stressJinvT, buoyJinvT, e, v); // added buoyJinvT
 }
 
+// Simplex version of ForceMult with the DofToQuad::FULL tables, B is
+// NQ x L2 dofs and G is NQ x DIM x H1 dofs. The energy is interpolated at
+// each point and contracted with stressJinvT and the gradients of the H1
+// basis, v(i,c) = sum_q e(q) sum_d G(q,d,i) sJit(q,d,c).
+template<int DIM> static
+void ForceMultSimplex(const int NE, const int NQ,
+                      const Array<double> &B_,
+                      const Array<double> &G_,
+                      const DenseTensor &sJit_,
+                      const Vector &x, Vector &y)
+{
+   const int NL = B_.Size() / NQ;
+   const int ND = G_.Size() / (NQ*DIM);
+   auto b = Reshape(B_.Read(), NQ, NL);
+   auto g = Reshape(G_.Read(), NQ, DIM, ND);
+   const double *StressJinvT = Read(sJit_.GetMemory(), NQ*NE*DIM*DIM);
+   auto sJit = Reshape(StressJinvT, NQ, NE, DIM, DIM);
+   auto energy = Reshape(x.Read(), NL, NE);
+   const double eps1 = std::numeric_limits<double>::epsilon();
+   const double eps2 = eps1*eps1;
+   auto velocity = Reshape(y.Write(), ND, DIM, NE);
+   MFEM_FORALL(e, NE,
+   {
+      for (int c = 0; c < DIM; ++c)
+      {
+         for (int i = 0; i < ND; ++i) { velocity(i,c,e) = 0.0; }
+      }
+      for (int q = 0; q < NQ; ++q)
+      {
+         double E = 0.0;
+         for (int l = 0; l < NL; ++l) { E += b(q,l) * energy(l,e); }
+         for (int c = 0; c < DIM; ++c)
+         {
+            double es[DIM];
+            for (int d = 0; d < DIM; ++d) { es[d] = E * sJit(q,e,d,c); }
+            for (int i = 0; i < ND; ++i)
+            {
+               double u = 0.0;
+               for (int d = 0; d < DIM; ++d) { u += g(q,d,i) * es[d]; }
+               velocity(i,c,e) += u;
+            }
+         }
+      }
+      for (int c = 0; c < DIM; ++c)
+      {
+         for (int i = 0; i < ND; ++i)
+         {
+            if (fabs(velocity(i,c,e)) < eps2) { velocity(i,c,e) = 0.0; }
+         }
+      }
+   });
+}
+
 void ForcePAOperator::Mult(const Vector &x, Vector &y) const
 {
    if (L2R) { L2R->Mult(x, X); }
    else { X = x; }
-   ForceMult(dim, D1D, Q1D, L1D, D1D, NE,
-             L2D2Q->B, H1D2Q->Bt, H1D2Q->Gt,
-             qdata.stressJinvT, qdata.buoyJinvT, X, Y); // added buoyJinvT
+   if (!tensor)
+   {
+      if (dim == 2)
+      { ForceMultSimplex<2>(NE, NQ, L2D2Q->B, H1D2Q->G, qdata.stressJinvT, X, Y); }
+      else
+      { ForceMultSimplex<3>(NE, NQ, L2D2Q->B, H1D2Q->G, qdata.stressJinvT, X, Y); }
+   }
+   else
+   {
+      ForceMult(dim, D1D, Q1D, L1D, D1D, NE,
+                L2D2Q->B, H1D2Q->Bt, H1D2Q->Gt,
+                qdata.stressJinvT, qdata.buoyJinvT, X, Y); // added buoyJinvT
+   }
    H1R->MultTranspose(Y, y);
 }
 
@@ -1662,12 +1894,59 @@ static void ForceMultTranspose(const int DIM, const int D1D, const int Q1D,
    call[id](NE, L2Bt, H1B, H1G, stressJinvT, buoyJinvT, v, e); // add buoyJinvT
 }
 
+// Simplex version of ForceMultTranspose with the DofToQuad::FULL tables,
+// e(l) = sum_q B(q,l) sum_c sum_d sJit(q,d,c) sum_i G(q,d,i) v(i,c).
+template<int DIM> static
+void ForceMultTransposeSimplex(const int NE, const int NQ,
+                               const Array<double> &B_,
+                               const Array<double> &G_,
+                               const DenseTensor &sJit_,
+                               const Vector &x, Vector &y)
+{
+   const int NL = B_.Size() / NQ;
+   const int ND = G_.Size() / (NQ*DIM);
+   auto b = Reshape(B_.Read(), NQ, NL);
+   auto g = Reshape(G_.Read(), NQ, DIM, ND);
+   const double *StressJinvT = Read(sJit_.GetMemory(), NQ*NE*DIM*DIM);
+   auto sJit = Reshape(StressJinvT, NQ, NE, DIM, DIM);
+   auto velocity = Reshape(x.Read(), ND, DIM, NE);
+   auto energy = Reshape(y.Write(), NL, NE);
+   MFEM_FORALL(e, NE,
+   {
+      for (int l = 0; l < NL; ++l) { energy(l,e) = 0.0; }
+      for (int q = 0; q < NQ; ++q)
+      {
+         double u = 0.0;
+         for (int c = 0; c < DIM; ++c)
+         {
+            for (int d = 0; d < DIM; ++d)
+            {
+               double gv = 0.0;
+               for (int i = 0; i < ND; ++i) { gv += g(q,d,i) * velocity(i,c,e); }
+               u += sJit(q,e,d,c) * gv;
+            }
+         }
+         for (int l = 0; l < NL; ++l) { energy(l,e) += b(q,l) * u; }
+      }
+   });
+}
+
 void ForcePAOperator::MultTranspose(const Vector &x, Vector &y) const
 {
    H1R->Mult(x, Y);
-   ForceMultTranspose(dim, D1D, Q1D, L1D, NE,
-                      L2D2Q->Bt, H1D2Q->B, H1D2Q->G,
-                      qdata.stressJinvT, qdata.buoyJinvT, Y, X); // add qdata.buoyJinvT
+   if (!tensor)
+   {
+      if (dim == 2)
+      { ForceMultTransposeSimplex<2>(NE, NQ, L2D2Q->B, H1D2Q->G, qdata.stressJinvT, Y, X); }
+      else
+      { ForceMultTransposeSimplex<3>(NE, NQ, L2D2Q->B, H1D2Q->G, qdata.stressJinvT, Y, X); }
+   }
+   else
+   {
+      ForceMultTranspose(dim, D1D, Q1D, L1D, NE,
+                         L2D2Q->Bt, H1D2Q->B, H1D2Q->G,
+                         qdata.stressJinvT, qdata.buoyJinvT, Y, X); // add qdata.buoyJinvT
+   }
    if (L2R) { L2R->MultTranspose(X, y); }
    else { y = X; }
 }
@@ -27,6 +27,22 @@ namespace mfem
 namespace geodynamics
 {
 
+// True for meshes of quadrilaterals or hexahedra, which use the sum
+// factorization kernels; simplex meshes use the full basis tables at the
+// quadrature points. The element types come from the serial mesh, so the
+// answer is the same on all ranks, also on ranks without elements. The
+// simplex path applies the tables of element 0 to every element, so mixed
+// meshes are rejected instead of giving wrong forces.
+inline bool TensorMesh(const Mesh &mesh)
+{
+   const int gen = mesh.MeshGenerator();
+   if (gen == 2) { return true; }
+   MFEM_VERIFY(gen == 1 || mesh.Dimension() == 1,
+               "Mixed element meshes are not supported, MeshGenerator() = "
+               << gen);
+   return false;
+}
+
 // Container for all data needed at quadrature points.
 struct QuadratureData
 {
@@ -73,6 +89,11 @@ struct QuadratureData
    double mscale;
    double vbc_max_val;
 
+   // Selective mass scaling: inertia factor (>= 1) of each element. The
+   // velocity mass uses rho0 times the factor and the time step estimate of
+   // the element grows with its square root. All ones when it is off.
+   Vector elem_mscale;
+
    // gravity
    double gravity;
    
@@ -83,7 +104,8 @@ struct QuadratureData
         buoyJinvT(NE * quads_per_el, dim, dim),
       //   epsJinvT(NE * quads_per_el, dim, dim),
       //   plsJinvT(NE * quads_per_el, dim, dim),
-        rho0DetJ0w(NE * quads_per_el) { }
+        rho0DetJ0w(NE * quads_per_el),
+        elem_mscale(NE) { elem_mscale = 1.0; }
    void Resize(int dim, int NE, int quads_per_el)
    {
       Jac0inv.SetSize(dim, dim, NE * quads_per_el);
@@ -91,6 +113,8 @@ struct QuadratureData
       tauJinvT.SetSize(NE * quads_per_el, dim, dim);
       buoyJinvT.SetSize(NE * quads_per_el, dim, dim);
       rho0DetJ0w.SetSize(NE * quads_per_el);
+      elem_mscale.SetSize(NE);
+      elem_mscale = 1.0;
    }
 };
 
@@ -166,6 +190,34 @@ public:
                                        DenseMatrix &elmat);
 };
 
+// Element assembly (EA) of the same force operator as ForceIntegrator. The
+// element matrices are built in one batched kernel from the basis tables of
+// the reference element, and both products are applied element by element
+// through the element restrictions, without forming a global sparse matrix.
+class ForceEAOperator : public Operator
+{
+private:
+   const int dim, NQ;
+   int NE, ND, NL;
+   const QuadratureData &qdata;
+   ParFiniteElementSpace &H1, &L2;
+   const DofToQuad *H1D2Q, *L2D2Q;
+   // Element matrices, (ND x dim) x NL per element.
+   Vector elmats;
+   mutable Vector X, Y;
+public:
+   ForceEAOperator(const QuadratureData&,
+                   ParFiniteElementSpace&,
+                   ParFiniteElementSpace&,
+                   const IntegrationRule&);
+   // Recomputes the element matrices from qdata.stressJinvT.
+   void Assemble();
+   virtual void Mult(const Vector&, Vector&) const;
+   virtual void MultTranspose(const Vector&, Vector&) const;
+   long MemoryBytes() const
+   { return sizeof(double) * ((long) elmats.Size() + X.Size() + Y.Size()); }
+};
+
 class BodyForceIntegrator : public LinearFormIntegrator
 {
    using LinearFormIntegrator::AssembleRHSElementVect;
@@ -185,11 +237,12 @@ class StressPAOperator : public Operator
 { 
    private:
    const int dim, NE;
+   const bool tensor;
    const QuadratureData &qdata;
    const ParFiniteElementSpace &H1, &L2;
    const Operator *H1R, *L2R;
    const IntegrationRule &ir1D;
-   const int D1D, Q1D, L1D, H1sz, L2sz;
+   const int D1D, Q1D, L1D, NQ, H1sz, L2sz;
    const DofToQuad *L2D2Q, *H1D2Q;
    mutable Vector X, Y; 
    public:
@@ -207,11 +260,13 @@ class ForcePAOperator : public Operator
 {
 private:
    const int dim, NE;
+   // Sum factorization on quads/hexes, full basis tables on simplices.
+   const bool tensor;
    const QuadratureData &qdata;
    const ParFiniteElementSpace &H1, &L2;
    const Operator *H1R, *L2R;
    const IntegrationRule &ir1D;
-   const int D1D, Q1D, L1D, H1sz, L2sz;
+   const int D1D, Q1D, L1D, NQ, H1sz, L2sz;
    const DofToQuad *L2D2Q, *H1D2Q;
    mutable Vector X, Y;
 public:
@@ -235,6 +290,9 @@ private:
    OperatorPtr mass;
 public:
    MassPAOperator(ParFiniteElementSpace&, const IntegrationRule&, Coefficient&);
+   // Recomputes the mass data for moved mesh nodes or a changed coefficient;
+   // the number of elements and the dofs must be the same.
+   void Reassemble();
    virtual void Mult(const Vector&, Vector&) const;
    void MultFull(const Vector &x, Vector &y) const { mass->Mult(x, y); }
    virtual void SetEssentialTrueDofs(Array<int>&);
@@ -0,0 +1,117 @@
+#include "laghost_bc.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace mfem
+{
+   VelocityBC::VelocityBC(ParFiniteElementSpace &H1,
+                          const std::vector<int> &bc_id,
+                          const std::vector<double> &bc_vx,
+                          const std::vector<double> &bc_vy,
+                          const std::vector<double> &bc_vz,
+                          const double v_unit)
+      : max_speed(0.0)
+   {
+      const int dim = H1.GetMesh()->Dimension();
+      const int nbdr = H1.GetMesh()->bdr_attributes.Max();
+      const int nb = std::min<int>(nbdr, bc_id.size());
+      const std::vector<double> *bc_v[3] = { &bc_vx, &bc_vy, &bc_vz };
+      auto value = [&](int c, int i)
+      {
+         return (i < (int) bc_v[c]->size()) ? v_unit * (*bc_v[c])[i] : 0.0;
+      };
+
+      // Essential true dofs, one call per component over all the boundaries
+      // that constrain it.
+      Array<int> ess_bdr(nbdr), dofs_marker, dofs_list;
+      for (int c = 0; c < dim; c++)
+      {
+         ess_bdr = 0;
+         for (int i = 0; i < nb; i++)
+         {
+            if (ComponentMask(dim, bc_id[i]) & (1 << c)) { ess_bdr[i] = 1; }
+         }
+         H1.GetEssentialTrueDofs(ess_bdr, dofs_list, c);
+         ess_tdofs.Append(dofs_list);
+      }
+
+      // Boundary values per vdof; later boundaries overwrite earlier ones.
+      Vector v_all(H1.GetVSize());
+      Array<int> is_set(H1.GetVSize());
+      is_set = 0;
+      for (int i = 0; i < nb; i++)
+      {
+         const int mask = ComponentMask(dim, bc_id[i]);
+         if (mask == 0) { continue; }
+         double v2 = 0.0;
+         for (int c = 0; c < dim; c++) { v2 += value(c, i) * value(c, i); }
+         max_speed = std::max(max_speed, std::sqrt(v2));
+
+         ess_bdr = 0;
+         ess_bdr[i] = 1;
+         for (int c = 0; c < dim; c++)
+         {
+            if (!(mask & (1 << c))) { continue; }
+            H1.GetEssentialVDofs(ess_bdr, dofs_marker, c);
+            FiniteElementSpace::MarkerToList(dofs_marker, dofs_list);
+            for (int j = 0; j < dofs_list.Size(); j++)
+            {
+               v_all(dofs_list[j]) = value(c, i);
+               is_set[dofs_list[j]] = 1;
+            }
+         }
+      }
+
+      // Pack, so that every vdof appears once and Apply() has no conflicts.
+      int n = 0;
+      for (int k = 0; k < is_set.Size(); k++) { n += is_set[k]; }
+      vdofs.SetSize(n);
+      values.SetSize(n);
+      for (int k = 0, j = 0; k < is_set.Size(); k++)
+      {
+         if (!is_set[k]) { continue; }
+         vdofs[j] = k;
+         values(j++) = v_all(k);
+      }
+   }
+
+   int VelocityBC::ComponentMask(const int dim, const int id)
+   {
+      if (dim == 2)
+      {
+         switch (id)
+         {
+            case 1: return 1;
+            case 2: return 2;
+            case 3: return 3;
+            default: return 0;
+         }
+      }
+      switch (id)
+      {
+         case 1: return 1;
+         case 2: return 2;
+         case 3: return 4;
+         case 4: return 7;
+         case 5: return 3;
+         case 6: return 5;
+         case 7: return 6;
+         default: return 0;
+      }
+   }
+
+   void VelocityBC::Apply(Vector &v, const double scale) const
+   {
+      const int n = vdofs.Size();
+      const int *d = vdofs.Read();
+      const double *val = values.Read();
+      double *y = v.ReadWrite();
+      MFEM_FORALL(k, n, { y[d[k]] = scale * val[k]; });
+   }
+
+   double VelocityBC::RampScale(const double t, const double ramp_time)
+   {
+      if (ramp_time <= 0.0) { return 1.0; }
+      return std::min(1.0, std::max(0.0, t / ramp_time));
+   }
+}
@@ -0,0 +1,52 @@
+#ifndef MFEM_LAGHOST_BC
+#define MFEM_LAGHOST_BC
+
+#include "mfem.hpp"
+#include <vector>
+
+namespace mfem
+{
+   // Velocity (Dirichlet) boundary conditions.
+   //
+   // bc.bc_ids gives one type per boundary attribute (0 = free), selecting
+   // the constrained components:
+   //   2D: 1 = x, 2 = y, 3 = x and y
+   //   3D: 1 = x, 2 = y, 3 = z, 4 = all, 5 = x and y, 6 = x and z,
+   //       7 = y and z
+   // The boundaries are compiled once into the essential true dofs and a
+   // packed list of (vdof, velocity) pairs, so that applying the boundary
+   // velocities is a single scatter. Where boundaries meet, the one listed
+   // last in bc_ids sets the value, as before.
+   class VelocityBC
+   {
+   private:
+      Array<int> ess_tdofs;
+      Array<int> vdofs;
+      Vector values;
+      double max_speed;
+
+   public:
+      VelocityBC(ParFiniteElementSpace &H1, const std::vector<int> &bc_id,
+                 const std::vector<double> &bc_vx,
+                 const std::vector<double> &bc_vy,
+                 const std::vector<double> &bc_vz, const double v_unit);
+
+      // Bit c is set if the boundary type constrains component c; 0 for free
+      // boundaries and unknown types.
+      static int ComponentMask(const int dim, const int id);
+
+      const Array<int> &GetEssentialTrueDofs() const { return ess_tdofs; }
+
+      // Largest boundary velocity magnitude over the constrained boundaries.
+      double MaxSpeed() const { return max_speed; }
+
+      // v(vdof) = scale * value for all constrained vdofs of the H1 vector v.
+      void Apply(Vector &v, const double scale = 1.0) const;
+
+      // Linear ramp from 0 at t = 0 to 1 at t = ramp_time (1 if ramp_time is
+      // not positive).
+      static double RampScale(const double t, const double ramp_time);
+   };
+}
+
+#endif // MFEM_LAGHOST_BC
@@ -0,0 +1,53 @@
+#include "laghost_dt.hpp"
+#include <algorithm>
+
+namespace mfem
+{
+   TimeStepController::TimeStepController(double safety_, double growth_,
+                                          double retry_factor_,
+                                          int max_retries_)
+      : safety(safety_), growth(growth_), retry_factor(retry_factor_),
+        max_retries(max_retries_), retries(0)
+   {
+      MFEM_VERIFY(safety > 0.0 && safety <= 1.0,
+                  "solver.dt_safety must be in (0, 1]");
+      MFEM_VERIFY(growth >= 1.0, "solver.dt_growth must be >= 1");
+      MFEM_VERIFY(retry_factor > 0.0 && retry_factor < 1.0,
+                  "solver.dt_retry_factor must be in (0, 1)");
+   }
+
+   double TimeStepController::Set(const char *name, double dt)
+   {
+      limiter = name;
+      counts[limiter]++;
+      return dt;
+   }
+
+   double TimeStepController::Initial(double init_dt, double dt_est)
+   {
+      const double target = safety * dt_est;
+      if (init_dt > 0.0 && init_dt <= target) { return Set("init", init_dt); }
+      return Set("cfl", target);
+   }
+
+   double TimeStepController::Next(double dt, double dt_est)
+   {
+      const double target = safety * dt_est;
+      if (growth * dt < target) { return Set("growth", growth * dt); }
+      return Set("cfl", target);
+   }
+
+   double TimeStepController::Reject(double dt, double dt_est)
+   {
+      if (dt_est > 0.0) { return Set("reject", safety * dt_est); }
+      if (++retries > max_retries) { return Set("inverted", 0.0); }
+      return Set("inverted", retry_factor * dt);
+   }
+
+   void TimeStepController::PrintSummary(std::ostream &os) const
+   {
+      os << "Time step limiters:";
+      for (const auto &c : counts) { os << " " << c.first << " " << c.second; }
+      os << std::endl;
+   }
+}
@@ -0,0 +1,67 @@
+#ifndef MFEM_LAGHOST_DT
+#define MFEM_LAGHOST_DT
+
+#include "mfem.hpp"
+#include <map>
+#include <string>
+#include <iostream>
+
+namespace mfem
+{
+   // Time-step controller.
+   //
+   // The step size follows the global CFL estimate dt_est with a safety
+   // factor, target = safety * dt_est: it grows by at most a factor growth
+   // per step and drops to the target as soon as the estimate falls below
+   // dt / safety. With the default safety 0.8 the step keeps the margin of
+   // the former rule, which grew dt only while dt_est > 1.25 * dt, so small
+   // drops of the estimate do not reject steps. A step is rejected when
+   // dt_est < dt and repeated with the target. A zero estimate or a negative
+   // nodal volume means an inverted element; the step is then repeated with
+   // dt * retry_factor, at most max_retries times in a row, until
+   // Completed() reports a step that passed.
+   //
+   // Every decision records the limiter that set dt ("init", "cfl",
+   // "growth", "reject", "inverted"), for per-step logging and the end-of-run
+   // summary.
+   class TimeStepController
+   {
+   private:
+      double safety, growth, retry_factor;
+      int max_retries, retries;
+      std::string limiter;
+      std::map<std::string, long> counts;
+
+      double Set(const char *name, double dt);
+
+   public:
+      TimeStepController(double safety, double growth, double retry_factor,
+                         int max_retries);
+
+      // First step: init_dt if positive, capped by the estimate.
+      double Initial(double init_dt, double dt_est);
+
+      bool Accept(double dt, double dt_est) const
+      { return dt_est > 0.0 && dt_est >= dt; }
+
+      // Size of the next step after an accepted step of size dt.
+      double Next(double dt, double dt_est);
+
+      // Size for repeating a rejected step of size dt. Returns 0 when an
+      // inverted element persists after max_retries retries.
+      double Reject(double dt, double dt_est);
+
+      // Same as Reject() for an inversion found outside the estimate.
+      double Inverted(double dt) { return Reject(dt, 0.0); }
+
+      // The step passed all checks, including the volume check after Next();
+      // the count of retries in a row starts again.
+      void Completed() { retries = 0; }
+
+      const std::string &Limiter() const { return limiter; }
+
+      void PrintSummary(std::ostream &os) const;
+   };
+}
+
+#endif // MFEM_LAGHOST_DT
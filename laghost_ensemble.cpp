@@ -0,0 +1,141 @@
+#include "laghost_ensemble.hpp"
+#include <fstream>
+#include <sstream>
+
+namespace mfem
+{
+   static std::string Trim(const std::string &s)
+   {
+      const size_t b = s.find_first_not_of(" \t\r");
+      if (b == std::string::npos) { return ""; }
+      const size_t e = s.find_last_not_of(" \t\r");
+      return s.substr(b, e - b + 1);
+   }
+
+   // Sends the string s from rank 0 of comm to all the other ranks.
+   static void BcastString(std::string &s, MPI_Comm comm)
+   {
+      long n = s.size();
+      MPI_Bcast(&n, 1, MPI_LONG, 0, comm);
+      s.resize(n);
+      MPI_Bcast(&s[0], n, MPI_CHAR, 0, comm);
+   }
+
+   Ensemble::Ensemble(MPI_Comm world_, const std::string &file)
+      : world(world_), comm(world_), mesh_comm(MPI_COMM_NULL), member(0),
+        members(0)
+   {
+      if (file.empty()) { return; }
+
+      int myid, nranks;
+      MPI_Comm_rank(world, &myid);
+      MPI_Comm_size(world, &nranks);
+
+      std::string text;
+      int ok = 1;
+      if (myid == 0)
+      {
+         std::ifstream ifs(file.c_str());
+         ok = ifs.good();
+         std::ostringstream os;
+         os << ifs.rdbuf();
+         text = os.str();
+      }
+      MPI_Bcast(&ok, 1, MPI_INT, 0, world);
+      MFEM_VERIFY(ok, "Cannot open the ensemble file " << file);
+      BcastString(text, world);
+
+      std::vector<std::string> lines;
+      std::istringstream is(text);
+      std::string line;
+      while (std::getline(is, line))
+      {
+         line = Trim(line);
+         if (line.empty() || line[0] == '#') { continue; }
+         lines.push_back(line);
+      }
+      members = lines.size();
+      MFEM_VERIFY(members > 0, "The ensemble file " << file << " is empty");
+      MFEM_VERIFY(members <= nranks, "The ensemble has " << members
+                  << " members but the job only " << nranks << " ranks");
+
+      member = (long) myid * members / nranks;
+      MPI_Comm_split(world, member, myid, &comm);
+
+      std::istringstream ls(lines[member]);
+      std::string item;
+      while (std::getline(ls, item, ';'))
+      {
+         item = Trim(item);
+         if (!item.empty()) { overrides.push_back(item); }
+      }
+   }
+
+   Ensemble::~Ensemble()
+   {
+      if (mesh_comm != MPI_COMM_NULL) { MPI_Comm_free(&mesh_comm); }
+      if (comm != world) { MPI_Comm_free(&comm); }
+   }
+
+   bool Ensemble::Overrides(const std::string &name) const
+   {
+      for (const auto &o : overrides)
+      {
+         if (Trim(o.substr(0, o.find('='))) == name) { return true; }
+      }
+      return false;
+   }
+
+   void Ensemble::SetBasename(std::string &basename) const
+   {
+      if (!Active() || Overrides("sim.basename")) { return; }
+      basename += "_" + std::to_string(member);
+   }
+
+   bool Ensemble::BuildsMesh(const std::string &key)
+   {
+      if (!Active()) { return true; }
+
+      // Group the world ranks by key: the color is the lowest rank with the
+      // same key.
+      int myid, nranks;
+      MPI_Comm_rank(world, &myid);
+      MPI_Comm_size(world, &nranks);
+      int len = key.size();
+      std::vector<int> lens(nranks), offsets(nranks + 1, 0);
+      MPI_Allgather(&len, 1, MPI_INT, lens.data(), 1, MPI_INT, world);
+      for (int r = 0; r < nranks; r++) { offsets[r+1] = offsets[r] + lens[r]; }
+      std::string all(offsets[nranks], ' ');
+      MPI_Allgatherv(const_cast<char *>(key.data()), len, MPI_CHAR, &all[0],
+                     lens.data(), offsets.data(), MPI_CHAR, world);
+      int color = myid;
+      for (int r = 0; r < myid; r++)
+      {
+         if (all.compare(offsets[r], lens[r], key) == 0) { color = r; break; }
+      }
+      MPI_Comm_split(world, color, myid, &mesh_comm);
+      return color == myid;
+   }
+
+   void Ensemble::ShareMesh(Mesh *&mesh) const
+   {
+      if (!Active()) { return; }
+
+      // The builder also reloads the printed mesh, so that all the ranks of
+      // a member partition exactly the same serial mesh.
+      int myid;
+      MPI_Comm_rank(mesh_comm, &myid);
+      std::string text;
+      if (myid == 0)
+      {
+         std::ostringstream os;
+         os.precision(16);
+         mesh->Print(os);
+         text = os.str();
+         delete mesh;
+      }
+      BcastString(text, mesh_comm);
+      std::istringstream is(text);
+      mesh = new Mesh(is, 1, 1);
+   }
+}
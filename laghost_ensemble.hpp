@@ -0,0 +1,58 @@
+#ifndef MFEM_LAGHOST_ENSEMBLE
+#define MFEM_LAGHOST_ENSEMBLE
+
+#include "mfem.hpp"
+#include <string>
+#include <vector>
+
+namespace mfem
+{
+   // Ensemble (parameter sweep) runs in one MPI job.
+   //
+   // sim.ensemble names a text file with one member per line. A line is a
+   // ';'-separated list of "section.name = value" overrides of the input
+   // file, e.g.
+   //    mat.friction_angle = [25.0]; bc.bc_unit = cm/yr
+   // Empty lines and lines starting with '#' are skipped. The world ranks
+   // are split into one group of consecutive ranks per member (group sizes
+   // differ by at most one) and each member runs its own model on its group.
+   // Members that do not override sim.basename write to
+   // <basename>_<member>.
+   //
+   // Without sim.ensemble there is a single member on the world
+   // communicator and nothing changes.
+   class Ensemble
+   {
+   private:
+      MPI_Comm world, comm, mesh_comm;
+      int member, members;
+      std::vector<std::string> overrides;
+
+   public:
+      Ensemble(MPI_Comm world, const std::string &file);
+      ~Ensemble();
+
+      bool Active() const { return members > 0; }
+      int Member() const { return member; }
+      int Size() const { return members; }
+
+      // Communicator of this member's ranks.
+      MPI_Comm GetComm() const { return comm; }
+
+      // "section.name = value" overrides of this member.
+      const std::vector<std::string> &Overrides() const { return overrides; }
+      bool Overrides(const std::string &name) const;
+
+      // Appends _<member> to basename, unless the member sets it.
+      void SetBasename(std::string &basename) const;
+
+      // Serial mesh sharing. The ranks are grouped by key, a string of all
+      // the settings the serial mesh depends on; BuildsMesh() is true on one
+      // rank per group, which reads and refines the mesh. ShareMesh() then
+      // sends it to the group, so that every rank has the same serial mesh.
+      bool BuildsMesh(const std::string &key);
+      void ShareMesh(Mesh *&mesh) const;
+   };
+}
+
+#endif // MFEM_LAGHOST_ENSEMBLE
@@ -91,4 +91,89 @@ namespace mfem
       }
    }
 
+   // Element attributes and dofs per element of an L2 grid function, whose
+   // dofs are numbered element by element.
+   static int L2Layout(const ParGridFunction &gf, Array<int> &attr)
+   {
+      const ParFiniteElementSpace &fes = *gf.ParFESpace();
+      MFEM_VERIFY(dynamic_cast<const L2_FECollection *>(fes.FEColl()),
+                  "Expected an L2 space");
+      MFEM_VERIFY(fes.GetVDim() == 1 || fes.GetOrdering() == Ordering::byNODES,
+                  "Expected byNODES ordering");
+      const int NE = fes.GetNE();
+      attr.SetSize(NE);
+      for (int e = 0; e < NE; e++) { attr[e] = fes.GetAttribute(e) - 1; }
+      return (NE > 0) ? fes.GetFE(0)->GetDof() : 0;
+   }
+
+   void ProjectPWConstL2(const Vector &vals, ParGridFunction &gf)
+   {
+      Array<int> attr;
+      const int ND = L2Layout(gf, attr);
+      const int NE = attr.Size(), NV = gf.ParFESpace()->GetVDim();
+      const int ndofs = gf.ParFESpace()->GetNDofs(), NA = vals.Size();
+      const auto A = attr.Read();
+      const auto V = vals.Read();
+      auto G = gf.Write();
+      MFEM_FORALL(i, NE*ND,
+      {
+         const int a = A[i / ND];
+         const double v = (a >= 0 && a < NA) ? V[a] : 0.0;
+         for (int c = 0; c < NV; c++) { G[c*ndofs + i] = v; }
+      });
+   }
+
+   void ProjectMaterialIndicators(ParGridFunction &comp_gf)
+   {
+      Array<int> attr;
+      const int ND = L2Layout(comp_gf, attr);
+      const int NE = attr.Size(), NV = comp_gf.ParFESpace()->GetVDim();
+      const int ndofs = comp_gf.ParFESpace()->GetNDofs();
+      const auto A = attr.Read();
+      auto G = comp_gf.Write();
+      MFEM_FORALL(i, NE*ND,
+      {
+         const int a = A[i / ND];
+         for (int c = 0; c < NV; c++) { G[c*ndofs + i] = (a == c) ? 1.0 : 0.0; }
+      });
+   }
+
+   void ProjectInitialStress(const Vector &rho, const double gravity,
+                             const double thickness, const bool lithostatic,
+                             ParGridFunction &s_gf)
+   {
+      Array<int> attr;
+      const int ND = L2Layout(s_gf, attr);
+      const int NE = attr.Size(), NV = s_gf.ParFESpace()->GetVDim();
+      const int ndofs = s_gf.ParFESpace()->GetNDofs(), NA = rho.Size();
+      ParMesh *pmesh = s_gf.ParFESpace()->GetParMesh();
+      const int dim = pmesh->Dimension();
+      const double atm = -101325; // 1 atm in Pa
+      s_gf = 0.0;
+      if (NE == 0) { return; }
+
+      // Physical coordinates of the L2 nodes, element by element.
+      const FiniteElement &fe = *s_gf.ParFESpace()->GetFE(0);
+      MFEM_VERIFY(dynamic_cast<const NodalFiniteElement *>(&fe),
+                  "ProjectInitialStress needs a nodal L2 basis");
+      const GeometricFactors *geom =
+         pmesh->GetGeometricFactors(fe.GetNodes(),
+                                    GeometricFactors::COORDINATES);
+      const auto X = Reshape(geom->X.Read(), ND, dim, NE);
+      const auto A = attr.Read();
+      const auto R = rho.Read();
+      auto G = s_gf.ReadWrite();
+      MFEM_FORALL(i, NE*ND,
+      {
+         const int e = i / ND, k = i % ND, a = A[e];
+         double p = atm;
+         if (lithostatic)
+         {
+            const double d = (a >= 0 && a < NA) ? R[a] : 0.0;
+            p -= fabs(thickness - X(k, dim-1, e)) * d * gravity;
+         }
+         for (int c = 0; c < dim && c < NV; c++) { G[c*ndofs + i] = p; }
+      });
+   }
+
 }
@@ -16,6 +16,18 @@ namespace mfem
    double y_l2(const Vector &);
    double z_l2(const Vector &);
 
+   // Dof-wise initial fields on L2 spaces, filled directly from the element
+   // attributes and the nodal coordinates instead of ProjectCoefficient.
+   // Sets every dof of element e to vals(attr(e)-1), in all components.
+   void ProjectPWConstL2(const Vector &vals, ParGridFunction &gf);
+   // Component i of comp_gf is 1 in the elements of material i (attr-1).
+   void ProjectMaterialIndicators(ParGridFunction &comp_gf);
+   // Atmospheric pressure on the normal stress components, plus the
+   // lithostatic load of density rho(attr-1) below z = thickness if asked.
+   void ProjectInitialStress(const Vector &rho, const double gravity,
+                             const double thickness, const bool lithostatic,
+                             ParGridFunction &s_gf);
+
    static void principal_stresses2(const double* s, double p[2],
                                 double& cos2t, double& sin2t)
    {
@@ -0,0 +1,127 @@
+#include "laghost_memory.hpp"
+#include <cstdio>
+#include <iomanip>
+#include <unistd.h>
+#include <sys/resource.h>
+
+namespace mfem
+{
+   MemoryLedger::MemoryLedger(MPI_Comm comm_) : comm(comm_)
+   {
+      MPI_Comm_rank(comm, &myid);
+   }
+
+   void MemoryLedger::Set(const std::string &name, long bytes)
+   {
+      Bucket &b = buckets[name];
+      b.current = bytes;
+      b.peak = std::max(b.peak, bytes);
+   }
+
+   void MemoryLedger::BeginPhase(const std::string &name)
+   {
+      Phase &p = phases[name];
+      p.rss_begin = CurrentRSS();
+      p.hwm_begin = PeakRSS();
+   }
+
+   long MemoryLedger::EndPhase(const std::string &name)
+   {
+      Phase &p = phases[name];
+      const long net = CurrentRSS() - p.rss_begin;
+      const long spike = PeakRSS() - p.hwm_begin;
+      p.max_net = std::max(p.max_net, net);
+      p.max_spike = std::max(p.max_spike, spike);
+      p.count++;
+      return spike;
+   }
+
+   void MemoryLedger::Report(std::ostream &os) const
+   {
+      const double MB = 1024.0*1024.0;
+      struct { long val; int rank; } in[2], out[2];
+      long sums[2], gsums[2];
+
+      if (myid == 0)
+      {
+         os << "Memory by subsystem (MB): "
+            << "current max [rank] / sum, peak max [rank] / sum" << std::endl;
+      }
+      for (const auto &b : buckets)
+      {
+         in[0].val = b.second.current; in[0].rank = myid;
+         in[1].val = b.second.peak;    in[1].rank = myid;
+         sums[0] = b.second.current; sums[1] = b.second.peak;
+         MPI_Reduce(in, out, 2, MPI_LONG_INT, MPI_MAXLOC, 0, comm);
+         MPI_Reduce(sums, gsums, 2, MPI_LONG, MPI_SUM, 0, comm);
+         if (myid == 0)
+         {
+            os << "   " << std::left << std::setw(20) << b.first << std::right
+               << std::fixed << std::setprecision(1)
+               << std::setw(10) << out[0].val/MB << " [" << out[0].rank << "] / "
+               << gsums[0]/MB << ","
+               << std::setw(10) << out[1].val/MB << " [" << out[1].rank << "] / "
+               << gsums[1]/MB << std::endl;
+         }
+      }
+
+      if (myid == 0 && !phases.empty())
+      {
+         os << "Memory growth by phase (MB): "
+            << "retained max [rank], high-water mark increase max [rank]"
+            << std::endl;
+      }
+      for (const auto &p : phases)
+      {
+         in[0].val = p.second.max_net;   in[0].rank = myid;
+         in[1].val = p.second.max_spike; in[1].rank = myid;
+         MPI_Reduce(in, out, 2, MPI_LONG_INT, MPI_MAXLOC, 0, comm);
+         if (myid == 0)
+         {
+            os << "   " << std::left << std::setw(20) << p.first << std::right
+               << std::fixed << std::setprecision(1)
+               << std::setw(10) << out[0].val/MB << " [" << out[0].rank << "],"
+               << std::setw(10) << out[1].val/MB << " [" << out[1].rank << "]"
+               << "  (" << p.second.count << " calls)" << std::endl;
+         }
+      }
+
+      long rss[2] = { CurrentRSS(), PeakRSS() }, grss_max[2], grss_sum[2];
+      MPI_Reduce(rss, grss_max, 2, MPI_LONG, MPI_MAX, 0, comm);
+      MPI_Reduce(rss, grss_sum, 2, MPI_LONG, MPI_SUM, 0, comm);
+      if (myid == 0)
+      {
+         os << "   " << std::left << std::setw(20) << "process RSS" << std::right
+            << std::fixed << std::setprecision(1)
+            << std::setw(10) << grss_max[0]/MB << " / " << grss_sum[0]/MB << ","
+            << std::setw(10) << grss_max[1]/MB << " / " << grss_sum[1]/MB
+            << std::endl;
+      }
+   }
+
+   long MemoryLedger::CurrentRSS()
+   {
+      long pages = 0;
+#ifndef __APPLE__
+      FILE *f = fopen("/proc/self/statm", "r");
+      if (f)
+      {
+         long size;
+         if (fscanf(f, "%ld %ld", &size, &pages) != 2) { pages = 0; }
+         fclose(f);
+      }
+#endif
+      return pages * sysconf(_SC_PAGESIZE);
+   }
+
+   long MemoryLedger::PeakRSS()
+   {
+      struct rusage usage;
+      if (getrusage(RUSAGE_SELF, &usage)) { return 0; }
+#ifndef __APPLE__
+      return usage.ru_maxrss * 1024L; // kilobytes
+#else
+      return usage.ru_maxrss;         // bytes
+#endif
+   }
+}
@@ -0,0 +1,61 @@
+#ifndef MFEM_LAGHOST_MEMORY
+#define MFEM_LAGHOST_MEMORY
+
+#include "mfem.hpp"
+#include <map>
+#include <string>
+#include <iostream>
+
+namespace mfem
+{
+   // Per-subsystem memory accounting.
+   //
+   // Subsystems are named buckets whose size in bytes is reported by their
+   // owners (quadrature data, assembled matrices, state vectors, ...); the
+   // ledger keeps the current and the peak value of each. Phases bracket
+   // transient work (remeshing, operator rebuilds) and record how much the
+   // process resident set and its high-water mark grew while they ran, which
+   // catches temporaries that are never reported as a subsystem.
+   //
+   // All ranks must touch the same subsystems and phases, since the reports
+   // reduce them by name.
+   class MemoryLedger
+   {
+   private:
+      struct Bucket
+      {
+         long current = 0, peak = 0;
+      };
+      struct Phase
+      {
+         long rss_begin = 0, hwm_begin = 0;
+         long max_net = 0, max_spike = 0;
+         int count = 0;
+      };
+      MPI_Comm comm;
+      int myid;
+      std::map<std::string, Bucket> buckets;
+      std::map<std::string, Phase> phases;
+
+   public:
+      MemoryLedger(MPI_Comm comm);
+
+      // Sets the current size of a subsystem, in bytes.
+      void Set(const std::string &name, long bytes);
+
+      // Brackets a phase. EndPhase() returns how much this phase raised the
+      // resident high-water mark of this rank, in bytes.
+      void BeginPhase(const std::string &name);
+      long EndPhase(const std::string &name);
+
+      // Collective. Prints current/peak per subsystem (max over ranks, the
+      // rank holding it, and the sum) and the phase growth on rank 0.
+      void Report(std::ostream &os) const;
+
+      // Current and peak resident set size of this process, in bytes.
+      static long CurrentRSS();
+      static long PeakRSS();
+   };
+}
+
+#endif // MFEM_LAGHOST_MEMORY
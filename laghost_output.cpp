@@ -0,0 +1,160 @@
+#include "laghost_output.hpp"
+#include <sstream>
+
+namespace mfem
+{
+   SurfaceSeriesWriter::SurfaceSeriesWriter(const std::string &fname,
+                                            const Array<ParGridFunction *> &surfaces,
+                                            int num_diag)
+      : comm(surfaces[0]->ParFESpace()->GetComm()),
+        ndiag(num_diag)
+   {
+      MPI_Comm_rank(comm, &myid);
+      MPI_Comm_size(comm, &nranks);
+
+      const int nsurf = surfaces.Size();
+      dim = surfaces[0]->ParFESpace()->GetVDim();
+      pfes.SetSize(nsurf);
+      ltsize.SetSize(nsurf);
+      gsize.SetSize(nsurf);
+      counts.SetSize(nsurf * nranks);
+      displs.SetSize(nsurf * nranks);
+
+      int max_local = 0, max_global = 0;
+      for (int s = 0; s < nsurf; s++)
+      {
+         pfes[s] = surfaces[s]->ParFESpace();
+         MFEM_VERIFY(pfes[s]->GetVDim() == dim,
+                     "All surfaces must have the same vector dimension.");
+         ltsize[s] = pfes[s]->GetTrueVSize() / dim;
+         max_local = std::max(max_local, ltsize[s] * dim);
+
+         int *cnt = counts.GetData() + s*nranks;
+         int *dsp = displs.GetData() + s*nranks;
+         const int lsize = ltsize[s] * dim;
+         MPI_Gather(&lsize, 1, MPI_INT, cnt, 1, MPI_INT, 0, comm);
+         long long total = 0;
+         if (myid == 0)
+         {
+            for (int r = 0; r < nranks; r++) { dsp[r] = total; total += cnt[r]; }
+            max_global = std::max(max_global, (int) total);
+         }
+         gsize[s] = total / dim;
+      }
+      send_buf.SetSize(max_local);
+      if (myid == 0) { recv_buf.SetSize(max_global); }
+
+      if (myid == 0)
+      {
+         ofs.open(fname.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+         MFEM_VERIFY(ofs.good(), "Cannot open surface series file " << fname);
+         const char magic[8] = {'L','G','H','S','U','R','F','1'};
+         const int hdr[3] = {dim, nsurf, ndiag};
+         ofs.write(magic, sizeof(magic));
+         ofs.write(reinterpret_cast<const char *>(hdr), sizeof(hdr));
+         ofs.write(reinterpret_cast<const char *>(gsize.GetData()),
+                   nsurf * sizeof(long long));
+         ofs.flush();
+      }
+   }
+
+   void SurfaceSeriesWriter::Append(int step, double t, double dt,
+                                    const Vector &diag,
+                                    const Array<ParGridFunction *> &surfaces)
+   {
+      MFEM_VERIFY(diag.Size() == ndiag, "Wrong number of diagnostics.");
+      MFEM_VERIFY(surfaces.Size() == pfes.Size(), "Wrong number of surfaces.");
+
+      if (myid == 0)
+      {
+         ofs.write(reinterpret_cast<const char *>(&step), sizeof(int));
+         ofs.write(reinterpret_cast<const char *>(&t), sizeof(double));
+         ofs.write(reinterpret_cast<const char *>(&dt), sizeof(double));
+         ofs.write(reinterpret_cast<const char *>(diag.GetData()),
+                   ndiag * sizeof(double));
+      }
+
+      for (int s = 0; s < surfaces.Size(); s++)
+      {
+         // Interleave the (byNODES) true dofs as x,y[,z] per node so that the
+         // rank-ordered concatenation is node-major on the root.
+         surfaces[s]->GetTrueDofs(tdofs);
+         const int n = ltsize[s];
+         for (int i = 0; i < n; i++)
+         {
+            for (int d = 0; d < dim; d++) { send_buf(i*dim + d) = tdofs(d*n + i); }
+         }
+         MPI_Gatherv(send_buf.GetData(), n*dim, MPI_DOUBLE,
+                     recv_buf.GetData(), counts.GetData() + s*nranks,
+                     displs.GetData() + s*nranks, MPI_DOUBLE, 0, comm);
+         if (myid == 0)
+         {
+            ofs.write(reinterpret_cast<const char *>(recv_buf.GetData()),
+                      gsize[s] * dim * sizeof(double));
+         }
+      }
+
+      // Flush per record so the series stays readable if the run aborts.
+      if (myid == 0) { ofs.flush(); }
+   }
+
+   FieldCadence::FieldCadence(const std::string &spec) : count(0)
+   {
+      std::istringstream iss(spec);
+      std::string item;
+      while (std::getline(iss, item, ','))
+      {
+         if (item.find_first_not_of(" ") == std::string::npos) { continue; }
+         const size_t colon = item.rfind(':');
+         MFEM_VERIFY(colon != std::string::npos,
+                     "Expected 'Field Name:n' in output cadence, got " << item);
+         const size_t b = item.find_first_not_of(" ");
+         const size_t e = item.find_last_not_of(" ", colon - 1);
+         const std::string name = item.substr(b, e - b + 1);
+         const int n = std::stoi(item.substr(colon + 1));
+         MFEM_VERIFY(n > 0, "Output cadence must be positive for " << name);
+         every[name] = n;
+      }
+   }
+
+   void FieldCadence::Select(DataCollection &dc)
+   {
+      for (auto &f : every)
+      {
+         if (count % f.second == 0 || !dc.HasField(f.first)) { continue; }
+         skipped[f.first] = dc.GetField(f.first);
+         dc.DeregisterField(f.first);
+      }
+      count++;
+   }
+
+   void FieldCadence::Select(CadenceVisItDataCollection &dc)
+   {
+      Select(static_cast<DataCollection &>(dc));
+      for (auto &f : skipped) { dc.ForgetField(f.first); }
+   }
+
+   void FieldCadence::Restore(DataCollection &dc)
+   {
+      for (auto &f : skipped) { dc.RegisterField(f.first, f.second); }
+      skipped.clear();
+   }
+
+   double GlobalMaxVelocity(const ParGridFunction &v_gf)
+   {
+      const int dim = v_gf.ParFESpace()->GetVDim();
+      const int n = v_gf.Size() / dim;
+      double local_max = 0.0;
+      for (int i = 0; i < n; i++)
+      {
+         double vv = 0.0;
+         for (int d = 0; d < dim; d++) { vv += v_gf(i + d*n) * v_gf(i + d*n); }
+         local_max = std::max(local_max, vv);
+      }
+      local_max = sqrt(local_max);
+      double global_max;
+      MPI_Allreduce(&local_max, &global_max, 1, MPI_DOUBLE, MPI_MAX,
+                    v_gf.ParFESpace()->GetComm());
+      return global_max;
+   }
+}
@@ -0,0 +1,122 @@
+#ifndef MFEM_LAGHOST_OUTPUT
+#define MFEM_LAGHOST_OUTPUT
+
+#include "mfem.hpp"
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace mfem
+{
+   // Appends per-step binary records of boundary submesh node coordinates
+   // and a few reduced diagnostics to a single file per run.
+   //
+   // File layout (native endianness):
+   //   header : char[8] "LGHSURF1", int32 dim, int32 nsurf, int32 ndiag,
+   //            int64 nnodes[nsurf]
+   //   record : int32 step, float64 t, float64 dt, float64 diag[ndiag],
+   //            then for each surface float64 xyz[nnodes*dim] (node-major)
+   //
+   // Only true dofs are written, so nodes shared between ranks appear once.
+   // The submesh topology is fixed, so the gather layout is set up once.
+   class SurfaceSeriesWriter
+   {
+   private:
+      MPI_Comm comm;
+      int myid, nranks, dim, ndiag;
+      Array<ParFiniteElementSpace *> pfes;
+      Array<int> ltsize;                  // local true nodes per surface
+      Array<int> counts, displs;          // nsurf x nranks, doubles per rank
+      Array<long long> gsize;             // global true nodes per surface
+      Vector tdofs, send_buf, recv_buf;
+      std::ofstream ofs;
+
+   public:
+      SurfaceSeriesWriter(const std::string &fname,
+                          const Array<ParGridFunction *> &surfaces,
+                          int num_diag);
+
+      // Collective over the communicator of the surfaces.
+      void Append(int step, double t, double dt, const Vector &diag,
+                  const Array<ParGridFunction *> &surfaces);
+   };
+
+   // Registry of quantities that exist only for output (log lines, VisIt,
+   // ParaView). Each entry is computed on first request after the state has
+   // changed and cached until the next Invalidate().
+   class DerivedFieldCache
+   {
+   private:
+      struct Entry
+      {
+         std::function<void()> compute;
+         long epoch;
+      };
+      std::map<std::string, Entry> fields;
+      long state_epoch;
+
+   public:
+      DerivedFieldCache() : state_epoch(0) { }
+
+      void Register(const std::string &name, std::function<void()> compute)
+      {
+         Entry &e = fields[name];
+         e.compute = compute;
+         e.epoch = -1;
+      }
+
+      // Marks all entries stale; call whenever the simulation state changes.
+      void Invalidate() { state_epoch++; }
+
+      void Require(const std::string &name)
+      {
+         auto it = fields.find(name);
+         MFEM_VERIFY(it != fields.end(), "Unknown derived field " << name);
+         if (it->second.epoch != state_epoch)
+         {
+            it->second.compute();
+            it->second.epoch = state_epoch;
+         }
+      }
+   };
+
+   // VisIt collection whose root file lists only the registered fields. The
+   // base class keeps the root file entry of a deregistered field, so a field
+   // skipped by FieldCadence would be listed without its data.
+   class CadenceVisItDataCollection : public VisItDataCollection
+   {
+   public:
+      using VisItDataCollection::VisItDataCollection;
+
+      void ForgetField(const std::string &name) { field_info_map.erase(name); }
+   };
+
+   // Per-field output cadence for a DataCollection, given as a comma separated
+   // list of "Field Name:n" pairs. A listed field is written on every n-th
+   // save of the collection; unlisted fields are written on every save.
+   class FieldCadence
+   {
+   private:
+      std::map<std::string, int> every;
+      std::map<std::string, GridFunction *> skipped;
+      int count;
+
+   public:
+      FieldCadence(const std::string &spec);
+
+      bool Empty() const { return every.empty(); }
+
+      // Deregisters the fields that are not due at this save.
+      void Select(DataCollection &dc);
+      // Same, also dropping the skipped fields from the VisIt root file.
+      void Select(CadenceVisItDataCollection &dc);
+      // Re-registers the fields removed by the last Select().
+      void Restore(DataCollection &dc);
+   };
+
+   // Global maximum of the pointwise velocity magnitude (byNODES ordering).
+   double GlobalMaxVelocity(const ParGridFunction &v_gf);
+}
+
+#endif // MFEM_LAGHOST_OUTPUT
@@ -0,0 +1,254 @@
+#include "laghost_profile.hpp"
+#include <fstream>
+#include <iomanip>
+
+namespace mfem
+{
+   RankProfile::RankProfile(MPI_Comm comm_, bool sync_wait_,
+                            const std::vector<std::string> &phase_names)
+      : comm(comm_), sync_wait(sync_wait_), names(phase_names),
+        elements(0), plastic_points(0), plastic_steps(0)
+   {
+      MPI_Comm_rank(comm, &myid);
+      MPI_Comm_size(comm, &nranks);
+      for (const auto &n : names) { phases[n]; }
+   }
+
+   RankProfile::Phase &RankProfile::Get(const std::string &name)
+   {
+      auto it = phases.find(name);
+      MFEM_VERIFY(it != phases.end(), "Unknown profile phase: " << name);
+      return it->second;
+   }
+
+   void RankProfile::Begin(const std::string &name)
+   {
+      Phase &p = Get(name);
+      p.sw.Clear();
+      p.sw.Start();
+   }
+
+   void RankProfile::End(const std::string &name)
+   {
+      Phase &p = Get(name);
+      p.sw.Stop();
+      p.compute += p.sw.RealTime();
+      if (!sync_wait) { return; }
+      p.sw.Clear();
+      p.sw.Start();
+      MPI_Barrier(comm);
+      p.sw.Stop();
+      p.wait += p.sw.RealTime();
+   }
+
+   void RankProfile::Set(const std::string &name, double compute, double wait)
+   {
+      Phase &p = Get(name);
+      p.compute = compute;
+      p.wait = wait;
+   }
+
+   void RankProfile::Report(std::ostream &os, const std::string &csv) const
+   {
+      const int np = names.size(), nv = 2*np + 2;
+      std::vector<double> mine(nv), all(myid == 0 ? nv*nranks : 0);
+      for (int i = 0; i < np; i++)
+      {
+         const Phase &p = phases.at(names[i]);
+         mine[2*i] = p.compute;
+         mine[2*i + 1] = p.wait;
+      }
+      mine[2*np] = elements;
+      mine[2*np + 1] = (plastic_steps > 0)
+                       ? (double) plastic_points / plastic_steps : 0.0;
+      MPI_Gather(mine.data(), nv, MPI_DOUBLE, all.data(), nv, MPI_DOUBLE, 0,
+                 comm);
+      if (myid != 0) { return; }
+
+      // Min/avg/max over ranks of entry k (or of the compute total, k < 0).
+      auto value = [&](int r, int k)
+      {
+         if (k >= 0) { return all[r*nv + k]; }
+         double t = 0.0;
+         for (int i = 0; i < np; i++) { t += all[r*nv + 2*i]; }
+         return t;
+      };
+      auto stats = [&](int k, double &vmin, double &vavg, double &vmax,
+                       int &rmax)
+      {
+         vmin = vmax = value(0, k); vavg = 0.0; rmax = 0;
+         for (int r = 0; r < nranks; r++)
+         {
+            const double v = value(r, k);
+            vmin = std::min(vmin, v);
+            if (v > vmax) { vmax = v; rmax = r; }
+            vavg += v / nranks;
+         }
+      };
+      auto line = [&](const std::string &label, int k, int kwait, int prec)
+      {
+         double vmin, vavg, vmax, wmin, wavg, wmax;
+         int rmax, rwmax;
+         stats(k, vmin, vavg, vmax, rmax);
+         os << "   " << std::left << std::setw(18) << label << std::right
+            << std::fixed << std::setprecision(prec)
+            << std::setw(10) << vmin << std::setw(10) << vavg
+            << std::setw(10) << vmax << " [" << std::setw(4) << rmax << "]";
+         if (kwait >= 0)
+         {
+            stats(kwait, wmin, wavg, wmax, rwmax);
+            os << std::setw(10) << wavg << std::setw(10) << wmax;
+         }
+         else { os << std::setw(20) << ""; }
+         os << std::setw(10) << std::setprecision(2)
+            << ((vavg > 0.0) ? vmax / vavg : 1.0) << std::endl;
+      };
+
+      os << std::endl << "Load balance over " << nranks << " ranks "
+         << "(time min / avg / max [rank], barrier wait avg / max, "
+         << "imbalance max/avg):" << std::endl;
+      for (int i = 0; i < np; i++) { line(names[i], 2*i, 2*i + 1, 3); }
+      line("total", -1, -1, 3);
+      line("elements", 2*np, -1, 0);
+      line("plastic pts/step", 2*np + 1, -1, 1);
+      os << "   (phase times include the MPI calls inside the phase)"
+         << std::endl;
+      if (!sync_wait)
+      {
+         os << "   (barrier waits are not measured without synchronization)"
+            << std::endl;
+      }
+
+      if (nranks <= 16)
+      {
+         os << "   rank  elements  plas/stp";
+         for (int i = 0; i < np; i++)
+         {
+            os << std::setw(20) << names[i] + " t/w";
+         }
+         os << std::endl;
+         for (int r = 0; r < nranks; r++)
+         {
+            os << "   " << std::setw(4) << r
+               << std::setw(10) << (long) value(r, 2*np)
+               << std::fixed << std::setprecision(1)
+               << std::setw(10) << value(r, 2*np + 1)
+               << std::setprecision(3);
+            for (int i = 0; i < np; i++)
+            {
+               os << std::setw(10) << value(r, 2*i)
+                  << std::setw(10) << value(r, 2*i + 1);
+            }
+            os << std::endl;
+         }
+      }
+
+      if (csv.empty()) { return; }
+      std::ofstream ofs(csv.c_str());
+      if (!ofs)
+      {
+         os << "Cannot open " << csv << " for the load-balance data."
+            << std::endl;
+         return;
+      }
+      ofs << "rank,elements,plastic_points_per_step";
+      for (int i = 0; i < np; i++)
+      {
+         ofs << "," << names[i] << "_time," << names[i] << "_barrier_wait";
+      }
+      ofs << std::endl;
+      ofs << std::setprecision(6);
+      for (int r = 0; r < nranks; r++)
+      {
+         ofs << r << "," << (long) value(r, 2*np)
+             << "," << value(r, 2*np + 1);
+         for (int i = 0; i < np; i++)
+         {
+            ofs << "," << value(r, 2*i) << "," << value(r, 2*i + 1);
+         }
+         ofs << std::endl;
+      }
+      os << "Load-balance data written to " << csv << std::endl;
+   }
+
+   std::map<std::string, HostSync::Site> &HostSync::Sites()
+   {
+      static std::map<std::string, Site> sites;
+      return sites;
+   }
+
+   void HostSync::Record(const char *site, bool valid, long bytes,
+                         double time)
+   {
+      Site &s = Sites()[site];
+      s.calls++;
+      if (!valid) { s.copies++; s.bytes += bytes; }
+      s.time += time;
+   }
+
+   const double *HostSync::Read(const char *site, const Vector &v)
+   {
+      return Read(site, v.GetMemory(), v.Size());
+   }
+
+   const double *HostSync::Read(const char *site, const Memory<double> &mem,
+                                int size)
+   {
+      StopWatch sw;
+      sw.Start();
+      const bool valid = mem.HostIsValid();
+      const double *d = mfem::HostRead(mem, size);
+      sw.Stop();
+      Record(site, valid, sizeof(double) * (long) size, sw.RealTime());
+      return d;
+   }
+
+   double *HostSync::ReadWrite(const char *site, Vector &v)
+   {
+      StopWatch sw;
+      sw.Start();
+      const bool valid = v.GetMemory().HostIsValid();
+      double *d = v.HostReadWrite();
+      sw.Stop();
+      Record(site, valid, sizeof(double) * (long) v.Size(), sw.RealTime());
+      return d;
+   }
+
+   void HostSync::Report(MPI_Comm comm, std::ostream &os)
+   {
+      int myid;
+      MPI_Comm_rank(comm, &myid);
+      const double MB = 1024.0*1024.0;
+      double tsum = 0.0, tmax;
+      if (myid == 0)
+      {
+         os << std::endl << "Host synchronisation by site "
+            << "(calls, copies, MB copied, time max [rank]):" << std::endl;
+      }
+      for (const auto &it : Sites())
+      {
+         const Site &s = it.second;
+         long cnt[3] = { s.calls, s.copies, s.bytes }, gcnt[3];
+         struct { double val; int rank; } in = { s.time, myid }, out;
+         MPI_Reduce(cnt, gcnt, 3, MPI_LONG, MPI_MAX, 0, comm);
+         MPI_Reduce(&in, &out, 1, MPI_DOUBLE_INT, MPI_MAXLOC, 0, comm);
+         tsum += s.time;
+         if (myid == 0)
+         {
+            os << "   " << std::left << std::setw(24) << it.first << std::right
+               << std::setw(10) << gcnt[0] << std::setw(10) << gcnt[1]
+               << std::fixed << std::setprecision(1)
+               << std::setw(10) << gcnt[2]/MB
+               << std::setprecision(4) << std::setw(12) << out.val
+               << " [" << out.rank << "]" << std::endl;
+         }
+      }
+      MPI_Reduce(&tsum, &tmax, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+      if (myid == 0)
+      {
+         os << "   " << std::left << std::setw(24) << "total" << std::right
+            << std::setw(42) << std::fixed << std::setprecision(4) << tmax
+            << std::endl;
+      }
+   }
+}
@@ -0,0 +1,97 @@
+#ifndef MFEM_LAGHOST_PROFILE
+#define MFEM_LAGHOST_PROFILE
+
+#include "mfem.hpp"
+#include <map>
+#include <string>
+#include <vector>
+#include <iostream>
+
+namespace mfem
+{
+   // Per-rank load-imbalance profile.
+   //
+   // Each phase accumulates the time of this rank in the phase and, when
+   // sync_wait is set, the time it then spends in a barrier waiting for the
+   // slowest rank. The phase time includes the MPI calls made inside the phase
+   // (CG reductions, halo exchanges), so the barrier wait is the imbalance at
+   // the phase end, not the whole communication cost. Phases timed elsewhere
+   // (the solver phases kept in TimingData) are copied in with Set(). The
+   // report gathers everything on rank 0 and prints min/avg/max per phase
+   // with the imbalance factor max/avg, the per-rank table for small runs,
+   // and optionally writes one CSV row per rank.
+   //
+   // The phase list is fixed at construction so that all ranks agree on it.
+   class RankProfile
+   {
+   private:
+      struct Phase
+      {
+         double compute = 0.0, wait = 0.0;
+         StopWatch sw;
+      };
+      MPI_Comm comm;
+      int myid, nranks;
+      bool sync_wait;
+      std::vector<std::string> names;
+      std::map<std::string, Phase> phases;
+      long elements, plastic_points, plastic_steps;
+
+      Phase &Get(const std::string &name);
+
+   public:
+      RankProfile(MPI_Comm comm, bool sync_wait,
+                  const std::vector<std::string> &phase_names);
+
+      // Brackets a phase. End() then waits at a barrier
+      // if sync_wait is set, and books that time as the phase wait.
+      void Begin(const std::string &name);
+      void End(const std::string &name);
+
+      // Overwrites the totals of a phase timed outside this class.
+      void Set(const std::string &name, double compute, double wait);
+
+      void SetElements(long ne) { elements = ne; }
+      // Points that yielded in one step; the report shows the mean per step.
+      void AddPlasticPoints(long n) { plastic_points += n; plastic_steps++; }
+
+      // Collective. Prints the summary on rank 0 and, if csv is not empty,
+      // writes the per-rank data to that file.
+      void Report(std::ostream &os, const std::string &csv) const;
+   };
+
+   // Host synchronisation points.
+   //
+   // Laghost code that needs data on the host between device kernels goes
+   // through these calls instead of calling HostRead()/HostReadWrite()
+   // directly, so that a run can report, per call site, how often the data
+   // had to be copied back from the device and how long the sync took. With
+   // a host backend (cpu, omp) the memory is always valid on the host and
+   // only the call counts grow.
+   //
+   // Report() reduces the sites by name, so all ranks must have passed
+   // through the same sites.
+   class HostSync
+   {
+   private:
+      struct Site
+      {
+         long calls = 0, copies = 0, bytes = 0;
+         double time = 0.0;
+      };
+      static std::map<std::string, Site> &Sites();
+      static void Record(const char *site, bool valid, long bytes,
+                         double time);
+
+   public:
+      static const double *Read(const char *site, const Vector &v);
+      static double *ReadWrite(const char *site, Vector &v);
+      static const double *Read(const char *site, const Memory<double> &mem,
+                                int size);
+
+      // Collective. Prints calls, copies, MB and time per site on rank 0.
+      static void Report(MPI_Comm comm, std::ostream &os);
+   };
+}
+
+#endif // MFEM_LAGHOST_PROFILE
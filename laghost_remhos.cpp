@@ -8,6 +8,7 @@
 #include "remhos_mono.hpp"
 #include "remhos_tools.hpp"
 #include "remhos_sync.hpp"
+#include "laghost_profile.hpp"
 
 // #include <unistd.h>
 
@@ -73,6 +74,16 @@ private:
    GridFunction &mesh_pos, *submesh_pos, &mesh_vel, &submesh_vel;
 
    mutable ParGridFunction x_gf;
+   // Product fields us_k, with face-neighbor data. Together with x_gf, all
+   // components are exchanged in one batched message per neighbor.
+   Array<ParGridFunction *> us_gf;
+   mutable Array<ParGridFunction *> exchange_gf;
+   mutable FaceNbrExchange nbr_exchange;
+
+   // Scratch pool for Mult(), sized once per mesh in the constructor, so the
+   // RK stages of the remap don't allocate.
+   mutable Vector du_HO, du_LO, d_us_HO, d_us_LO, s_ratio, u_new;
+   mutable Array<bool> s_bool_el, s_bool_dofs, s_bool_el_new, s_bool_dofs_new;
 
    double dt;
    TimeStepControl dt_control;
@@ -121,13 +132,26 @@ public:
       start_submesh_pos = sm_pos;
    }
 
-   virtual ~AdvectionOperator() { }
+   virtual ~AdvectionOperator()
+   {
+      for (int k = 0; k < us_gf.Size(); k++) { delete us_gf[k]; }
+   }
 };
 
 
 #ifdef MFEM_USE_MPI
 
 void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGridFunction &u_gf, int &mesh_order, int &order, bool &pa, bool &ncmesh) 
+{
+   Array<ParGridFunction *> no_products;
+   Remapping(pmesh, x, x_mod, u_gf, no_products, mesh_order, order, pa, ncmesh);
+}
+
+// Synchronized product remap. u_gf is the transported volume (mass) field and
+// every s_gfs[k] is an intensive quantity that is advected as the product
+// u*s_k in the same operator pass. On return s_gfs[k] holds the recovered
+// ratio us_k / u on the new mesh, so no separate division is needed.
+void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGridFunction &u_gf, Array<ParGridFunction *> &s_gfs, int &mesh_order, int &order, bool &pa, bool &ncmesh) 
 {
    MPI_Comm comm = pmesh->GetComm();
    int num_procs, myid;
@@ -178,7 +202,8 @@ void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGr
    bool visualization = false;
    bool visit = false;
    bool verify_bounds = false;
-   bool product_sync = false;
+   const int nprod = s_gfs.Size();
+   bool product_sync = (nprod > 0);
    int vis_steps = 100;
    // const char *device_config = "cpu";
    int precision = 16;
@@ -571,7 +596,7 @@ void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGr
 
    // Setup the initial conditions.
    const int vsize = pfes.GetVSize();
-   Array<int> offset((product_sync) ? 3 : 2);
+   Array<int> offset(2 + nprod);
    for (int i = 0; i < offset.Size(); i++) { offset[i] = i*vsize; }
    BlockVector S(offset, Device::GetMemoryType());
    // Primary scalar field is u.
@@ -581,23 +606,29 @@ void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGr
    // u.ProjectCoefficient(u0);
    u = u_gf;
    u.SyncAliasMemory(S);
-   // For the case of product remap, we also solve for s and u_s.
-   ParGridFunction s, us;
+   // For the case of product remap, we also solve for s and u_s. Every
+   // product field k lives in block k+1 of S, i.e., us_k = u * s_k.
+   ParGridFunction s;
+   Array<ParGridFunction *> us(nprod);
    Array<bool> u_bool_el, u_bool_dofs;
    if (product_sync)
    {
       s.SetSpace(&pfes);
       ComputeBoolIndicators(pmesh->GetNE(), u, u_bool_el, u_bool_dofs);
-      BoolFunctionCoefficient sc(s0_function, u_bool_el);
-      s.ProjectCoefficient(sc);
-
-      us.MakeRef(&pfes, S, offset[1]);
-      double *h_us = us.HostWrite();
-      const double *h_u = u.HostRead();
-      const double *h_s = s.HostRead();
-      // Simple - we don't target conservation at initialization.
-      for (int i = 0; i < s.Size(); i++) { h_us[i] = h_u[i] * h_s[i]; }
-      us.SyncAliasMemory(S);
+      for (int k = 0; k < nprod; k++)
+      {
+         MFEM_VERIFY(s_gfs[k]->Size() == vsize,
+                     "Product field " << k << " does not match the remap space.");
+         us[k] = new ParGridFunction(&pfes);
+         us[k]->MakeRef(&pfes, S, offset[k+1]);
+         double *h_us = us[k]->HostWrite();
+         const double *h_u = u.HostRead();
+         const double *h_s = s_gfs[k]->HostRead();
+         // Simple - we don't target conservation at initialization.
+         for (int i = 0; i < vsize; i++) { h_us[i] = h_u[i] * h_s[i]; }
+         us[k]->SyncAliasMemory(S);
+      }
+      s = *s_gfs[0];
    }
 
    // Smoothness indicator.
@@ -763,7 +794,7 @@ void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGr
       {
          VisualizeField(vis_s, vishost, visport, s, "Solution s",
                         Wx + Ww, Wy, Ww, Wh);
-         VisualizeField(vis_us, vishost, visport, us, "Solution u_s",
+         VisualizeField(vis_us, vishost, visport, *us[0], "Solution u_s",
                         Wx + 2*Ww, Wy, Ww, Wh);
       }
    }
@@ -771,12 +802,15 @@ void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGr
    // Record the initial mass.
    Vector masses(lumpedM);
    const double mass0_u_loc = lumpedM * u;
-   double mass0_u, mass0_us;
+   double mass0_u;
+   Vector mass0_us(nprod);
    MPI_Allreduce(&mass0_u_loc, &mass0_u, 1, MPI_DOUBLE, MPI_SUM, comm);
    if (product_sync)
    {
-      const double mass0_us_loc = lumpedM * us;
-      MPI_Allreduce(&mass0_us_loc, &mass0_us, 1, MPI_DOUBLE, MPI_SUM, comm);
+      Vector mass0_us_loc(nprod);
+      for (int k = 0; k < nprod; k++) { mass0_us_loc(k) = lumpedM * (*us[k]); }
+      MPI_Allreduce(mass0_us_loc.GetData(), mass0_us.GetData(), nprod,
+                    MPI_DOUBLE, MPI_SUM, comm);
    }
 
    // Setup of the FCT solver (if any).
@@ -828,12 +862,14 @@ void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGr
 
    ParGridFunction res = u;
    double residual = 0.0;
-   double s_min_glob = numeric_limits<double>::infinity(),
-          s_max_glob = -numeric_limits<double>::infinity();
+   Vector s_min_glob(nprod), s_max_glob(nprod);
+   s_min_glob = numeric_limits<double>::infinity();
+   s_max_glob = -numeric_limits<double>::infinity();
 
    // Time-integration (loop over the time iterations, ti, with a time-step dt).
    bool done = false;
    BlockVector Sold(S);
+   Array<bool> active_elem, active_dofs;
    int ti_total = 0, ti = 0;
 
    while (done == false)
@@ -845,17 +881,18 @@ void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGr
       if (lo_solver)  { lo_solver->UpdateTimeStep(dt_real); }
       if (fct_solver) { fct_solver->UpdateTimeStep(dt_real); }
 
-      if (product_sync)
+      for (int k = 0; k < nprod; k++)
       {
-         ComputeMinMaxS(pmesh->GetNE(), us, u, s_min_glob, s_max_glob);
+         ComputeMinMaxS(pmesh->GetNE(), *us[k], u, s_min_glob(k), s_max_glob(k),
+                        pmesh->GetComm());
 #ifdef REMHOS_FCT_PRODUCT_DEBUG
          if (myid == 0)
          {
-            std::cout << "   --- Full time step" << std::endl;
+            std::cout << "   --- Full time step, product " << k << std::endl;
             std::cout << "   in:  ";
             std::cout << std::scientific << std::setprecision(5);
-            std::cout << "min_s: " << s_min_glob
-                      << "; max_s: " << s_max_glob << std::endl;
+            std::cout << "min_s: " << s_min_glob(k)
+                      << "; max_s: " << s_max_glob(k) << std::endl;
          }
 #endif
       }
@@ -890,36 +927,39 @@ void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGr
       u.SyncMemory(S);
       if (product_sync)
       {
-         us.SyncMemory(S);
-
          // It is known that RK time integrators with more than 1 stage may
          // cause violation of the lower bounds for us.
          // The lower bound is corrected, causing small conservation error.
          // Correction can also be done with localized bounds for s, but for
          // now we have implemented only the minimum global bound.
          u.HostRead();
-         us.HostReadWrite();
          const int s = u.Size();
-         Array<bool> active_elem, active_dofs;
          ComputeBoolIndicators(NE, u, active_elem, active_dofs);
-         for (int i = 0; i < s; i++)
+         for (int k = 0; k < nprod; k++)
          {
-            if (active_dofs[i] == false) { continue; }
+            ParGridFunction &us_k = *us[k];
+            us_k.SyncMemory(S);
+            us_k.HostReadWrite();
+            for (int i = 0; i < s; i++)
+            {
+               if (active_dofs[i] == false) { continue; }
 
-            double us_min = u(i) * s_min_glob;
-            if (us(i) < us_min) { us(i) = us_min; }
-         }
+               double us_min = u(i) * s_min_glob(k);
+               if (us_k(i) < us_min) { us_k(i) = us_min; }
+            }
 
 #ifdef REMHOS_FCT_PRODUCT_DEBUG
-         ComputeMinMaxS(NE, us, u, s_min_glob, s_max_glob);
-         if (myid == 0)
-         {
-            std::cout << "   out: ";
-            std::cout << std::scientific << std::setprecision(5);
-            std::cout << "min_s: " << s_min_glob
-                      << "; max_s: " << s_max_glob << std::endl;
-         }
+            ComputeMinMaxS(NE, us_k, u, s_min_glob(k), s_max_glob(k),
+                           pmesh->GetComm());
+            if (myid == 0)
+            {
+               std::cout << "   out: ";
+               std::cout << std::scientific << std::setprecision(5);
+               std::cout << "min_s: " << s_min_glob(k)
+                         << "; max_s: " << s_max_glob(k) << std::endl;
+            }
 #endif
+         }
       }
 
       // Monotonicity check for debug purposes mainly.
@@ -1004,10 +1044,10 @@ void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGr
             if (product_sync)
             {
                // Recompute s = u_s / u.
-               ComputeRatio(pmesh->GetNE(), us, u, s, u_bool_el, u_bool_dofs);
+               ComputeRatio(pmesh->GetNE(), *us[0], u, s, u_bool_el, u_bool_dofs);
                VisualizeField(vis_s, vishost, visport, s, "Solution s",
                               Wx + Ww, Wy, Ww, Wh);
-               VisualizeField(vis_us, vishost, visport, us, "Solution u_s",
+               VisualizeField(vis_us, vishost, visport, *us[0], "Solution u_s",
                               Wx + 2*Ww, Wy, Ww, Wh);
             }
          }
@@ -1048,31 +1088,37 @@ void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGr
    }
 
    // Check for mass conservation.
-   double mass_u_loc = 0.0, mass_us_loc = 0.0;
+   double mass_u_loc = 0.0;
+   Vector mass_us_loc(nprod);
+   mass_us_loc = 0.0;
    if (exec_mode == 1)
    {
       ml.BilinearForm::operator=(0.0);
       ml.Assemble();
-      lumpedM.HostRead();
+      HostSync::Read("remap lumpedM", lumpedM);
       ml.SpMat().GetDiag(lumpedM);
-      mass_u_loc = lumpedM * u;
-      if (product_sync) { mass_us_loc = lumpedM * us; }
    }
-   else
-   {
-      mass_u_loc = masses * u;
-      if (product_sync) { mass_us_loc = masses * us; }
-   }
-   double mass_u, mass_us = 0.0, s_max = 0.0;
+   const Vector &final_masses = (exec_mode == 1) ? lumpedM : masses;
+   mass_u_loc = final_masses * u;
+   for (int k = 0; k < nprod; k++) { mass_us_loc(k) = final_masses * (*us[k]); }
+   double mass_u;
+   Vector mass_us(nprod), s_max(nprod);
    MPI_Allreduce(&mass_u_loc, &mass_u, 1, MPI_DOUBLE, MPI_SUM, comm);
    const double umax_loc = u.Max();
    MPI_Allreduce(&umax_loc, &umax, 1, MPI_DOUBLE, MPI_MAX, comm);
    if (product_sync)
    {
-      ComputeRatio(pmesh->GetNE(), us, u, s, u_bool_el, u_bool_dofs);
-      const double s_max_loc = s.Max();
-      MPI_Allreduce(&mass_us_loc, &mass_us, 1, MPI_DOUBLE, MPI_SUM, comm);
-      MPI_Allreduce(&s_max_loc, &s_max, 1, MPI_DOUBLE, MPI_MAX, comm);
+      // Recover s_k = us_k / u directly into the caller's fields.
+      Vector s_max_loc(nprod);
+      for (int k = 0; k < nprod; k++)
+      {
+         ComputeRatio(pmesh->GetNE(), *us[k], u, *s_gfs[k], u_bool_el, u_bool_dofs);
+         s_max_loc(k) = s_gfs[k]->Max();
+      }
+      MPI_Allreduce(mass_us_loc.GetData(), mass_us.GetData(), nprod,
+                    MPI_DOUBLE, MPI_SUM, comm);
+      MPI_Allreduce(s_max_loc.GetData(), s_max.GetData(), nprod,
+                    MPI_DOUBLE, MPI_MAX, comm);
    }
    if (myid == 0)
    {
@@ -1080,15 +1126,16 @@ void Remapping(ParMesh *pmesh, ParGridFunction &x, ParGridFunction &x_mod, ParGr
            << "Final mass u:  " << mass_u << endl
            << "Max value u:   " << umax << endl << setprecision(6)
            << "Mass loss u:   " << abs(mass0_u - mass_u) << endl;
-      if (product_sync)
+      for (int k = 0; k < nprod; k++)
       {
          cout << setprecision(10)
-              << "Final mass us: " << mass_us << endl
-              << "Max value s:   " << s_max << endl << setprecision(6)
-              << "Mass loss us:  " << abs(mass0_us - mass_us) << endl;
+              << "Final mass us[" << k << "]: " << mass_us(k) << endl
+              << "Max value s[" << k << "]:   " << s_max(k) << endl << setprecision(6)
+              << "Mass loss us[" << k << "]:  " << abs(mass0_us(k) - mass_us(k)) << endl;
       }
    }
    u_gf = u; 
+   for (int k = 0; k < nprod; k++) { delete us[k]; }
 
    // // Compute errors, if the initial condition is equal to the final solution
    // if (problem_num == 4) // solid body rotation
@@ -1179,8 +1226,39 @@ AdvectionOperator::AdvectionOperator(int size, BilinearForm &Mbf_,
    mesh_pos(pos), submesh_pos(sub_pos),
    mesh_vel(vel), submesh_vel(sub_vel),
    x_gf(Kbf.ParFESpace()),
+   nbr_exchange(*Kbf.ParFESpace(), size / Kbf.ParFESpace()->GetVSize()),
    asmbl(_asmbl), lom(_lom), dofs(_dofs),
-   ho_solver(hos), lo_solver(los), fct_solver(fct), mono_solver(mos) { }
+   ho_solver(hos), lo_solver(los), fct_solver(fct), mono_solver(mos)
+{
+   const int vsize = Kbf.ParFESpace()->GetVSize();
+   const int ne    = Kbf.ParFESpace()->GetNE();
+   du_HO.SetSize(vsize);
+   du_LO.SetSize(vsize);
+
+   const int nprod = nbr_exchange.NumFields() - 1;
+   if (nprod > 0)
+   {
+      d_us_HO.SetSize(vsize);
+      if (fct_solver && fct_solver->NeedsLOProductInput())
+      {
+         d_us_LO.SetSize(vsize);
+      }
+      s_ratio.SetSize(vsize);
+      u_new.SetSize(vsize);
+      s_bool_el.SetSize(ne);
+      s_bool_dofs.SetSize(vsize);
+      s_bool_el_new.SetSize(ne);
+      s_bool_dofs_new.SetSize(vsize);
+   }
+   us_gf.SetSize(nprod);
+   exchange_gf.SetSize(nprod + 1);
+   exchange_gf[0] = &x_gf;
+   for (int k = 0; k < nprod; k++)
+   {
+      us_gf[k] = new ParGridFunction(Kbf.ParFESpace());
+      exchange_gf[k+1] = us_gf[k];
+   }
+}
 
 void AdvectionOperator::Mult(const Vector &X, Vector &Y) const
 {
@@ -1204,7 +1282,7 @@ void AdvectionOperator::Mult(const Vector &X, Vector &Y) const
       Kbf.Assemble(0);
       ml.BilinearForm::operator=(0.0);
       ml.Assemble();
-      lumpedM.HostReadWrite();
+      HostSync::ReadWrite("remap lumpedM", lumpedM);
       ml.SpMat().GetDiag(lumpedM);
 
       M_HO.BilinearForm::operator=(0.0);
@@ -1259,17 +1337,24 @@ void AdvectionOperator::Mult(const Vector &X, Vector &Y) const
    Vector* xptr = const_cast<Vector*>(&X);
    u.MakeRef(*xptr, 0, size);
    d_u.MakeRef(Y, 0, size);
-   Vector du_HO(u.Size()), du_LO(u.Size());
 
+   // Exchange the face-neighbor data of u and all products at once.
+   const int nprod = us_gf.Size();
    x_gf = u;
-   x_gf.ExchangeFaceNbrData();
+   for (int k = 0; k < nprod; k++)
+   {
+      Vector us;
+      us.MakeRef(*xptr, (k+1)*size, size);
+      *us_gf[k] = us;
+   }
+   nbr_exchange.Exchange(exchange_gf);
 
    if (mono_solver) { mono_solver->CalcSolution(u, d_u); }
    else if (fct_solver)
    {
       MFEM_VERIFY(ho_solver && lo_solver, "FCT requires HO and LO solvers.");
 
-      lo_solver->CalcLOSolution(u, du_LO);
+      lo_solver->CalcLOSolution(u, x_gf.FaceNbrData(), du_LO);
       ho_solver->CalcHOSolution(u, du_HO);
 
       dofs.ComputeElementsMinMax(u, dofs.xe_min, dofs.xe_max, NULL, NULL);
@@ -1284,7 +1369,7 @@ void AdvectionOperator::Mult(const Vector &X, Vector &Y) const
    }
    else if (lo_solver)
    {
-      lo_solver->CalcLOSolution(u, d_u);
+      lo_solver->CalcLOSolution(u, x_gf.FaceNbrData(), d_u);
 
       if (dt_control == TimeStepControl::LOBoundsError)
       {
@@ -1300,42 +1385,44 @@ void AdvectionOperator::Mult(const Vector &X, Vector &Y) const
 
    d_u.SyncAliasMemory(Y);
 
-   // Remap the product field, if there is a product field.
-   if (X.Size() > size)
+   // Evolve u and get the new active dofs. These are shared by all products.
+   if (nprod > 0 && fct_solver && !mono_solver)
+   {
+      add(1.0, u, dt, d_u, u_new);
+      ComputeBoolIndicators(NE, u_new, s_bool_el_new, s_bool_dofs_new);
+   }
+
+   // Remap the product fields, if there are product fields. All of them use
+   // the same transported u, so they are advanced in the same operator pass.
+   for (int k = 0; k < nprod; k++)
    {
       MFEM_VERIFY(exec_mode == 1, "Products are processed only in remap mode.");
       MFEM_VERIFY(dt_control == TimeStepControl::FixedTimeStep,
                   "Automatic time step is not implemented for product remap.");
 
-      Vector us, d_us;
-      us.MakeRef(*xptr, size, size);
-      d_us.MakeRef(Y, size, size);
-
-      x_gf = us;
-      x_gf.ExchangeFaceNbrData();
+      ParGridFunction &us = *us_gf[k];
+      Vector d_us;
+      d_us.MakeRef(Y, (k+1)*size, size);
 
       if (mono_solver) { mono_solver->CalcSolution(us, d_us); }
       else if (fct_solver)
       {
          MFEM_VERIFY(ho_solver && lo_solver, "FCT requires HO and LO solvers.");
 
-         Vector d_us_HO(us.Size()), d_us_LO;
          if (fct_solver->NeedsLOProductInput())
          {
-            d_us_LO.SetSize(us.Size());
-            lo_solver->CalcLOSolution(us, d_us_LO);
+            lo_solver->CalcLOSolution(us, us.FaceNbrData(), d_us_LO);
          }
          ho_solver->CalcHOSolution(us, d_us_HO);
 
          // Compute the ratio s = us_old / u_old, and old active dofs.
-         Vector s(size);
-         Array<bool> s_bool_el, s_bool_dofs;
+         Vector &s = s_ratio;
          ComputeRatio(NE, us, u, s, s_bool_el, s_bool_dofs);
 #ifdef REMHOS_FCT_PRODUCT_DEBUG
          const int myid = x_gf.ParFESpace()->GetMyRank();
          if (myid == 0) { std::cout << "      --- RK stage" << std::endl; }
          std::cout << "      in:  ";
-         ComputeMinMaxS(s, s_bool_dofs, myid);
+         ComputeMinMaxS(s, s_bool_dofs, myid, x_gf.ParFESpace()->GetComm());
 #endif
 
          // Bounds for s, based on the old values (and old active dofs).
@@ -1346,13 +1433,7 @@ void AdvectionOperator::Mult(const Vector &X, Vector &Y) const
          dofs.ComputeBounds(dofs.xe_min, dofs.xe_max,
                             dofs.xi_min, dofs.xi_max, &s_bool_el);
 
-         // Evolve u and get the new active dofs.
-         Vector u_new(size);
-         add(1.0, u, dt, d_u, u_new);
-         Array<bool> s_bool_el_new, s_bool_dofs_new;
-         ComputeBoolIndicators(NE, u_new, s_bool_el_new, s_bool_dofs_new);
-
-         fct_solver->CalcFCTProduct(x_gf, lumpedM, d_us_HO, d_us_LO,
+         fct_solver->CalcFCTProduct(us, lumpedM, d_us_HO, d_us_LO,
                                     dofs.xi_min, dofs.xi_max,
                                     u_new,
                                     s_bool_el_new, s_bool_dofs_new, d_us);
@@ -1364,7 +1445,7 @@ void AdvectionOperator::Mult(const Vector &X, Vector &Y) const
          ComputeMinMaxS(NE, us_new, u_new, myid);
 #endif
       }
-      else if (lo_solver) { lo_solver->CalcLOSolution(us, d_us); }
+      else if (lo_solver) { lo_solver->CalcLOSolution(us, us.FaceNbrData(), d_us); }
       else if (ho_solver) { ho_solver->CalcHOSolution(us, d_us); }
       else { MFEM_ABORT("No solver was chosen."); }
 
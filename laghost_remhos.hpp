@@ -6,6 +6,7 @@ using namespace mfem;
 using namespace std;
 
 void Remapping(ParMesh *, ParGridFunction &, ParGridFunction &, ParGridFunction &, int &, int &, bool &, bool &);
+void Remapping(ParMesh *, ParGridFunction &, ParGridFunction &, ParGridFunction &, Array<ParGridFunction *> &, int &, int &, bool &, bool &);
 // void NCRemapping(ParNCMesh *, ParGridFunction &, ParGridFunction &, ParGridFunction &, int &, int &, bool &);
 
 // void Remapping_stress(ParMesh *, ParGridFunction &, ParGridFunction &, ParGridFunction &, int &, int &, bool &);
\ No newline at end of file
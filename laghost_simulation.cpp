@@ -0,0 +1,1291 @@
+#include "laghost_simulation.hpp"
+#include "laghost_rheology.hpp"
+#include "laghost_function.hpp"
+#include "laghost_tmop.hpp"
+#include "laghost_remhos.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace mfem
+{
+   bool MaterialValues(const std::vector<double> &vals, const int nmat,
+                       Vector &v)
+   {
+      v.SetSize(nmat);
+      if (vals.size() == 1) { v = vals[0]; return true; }
+      if ((int) vals.size() != nmat) { return false; }
+      for (int i = 0; i < nmat; i++) { v[i] = vals[i]; }
+      return true;
+   }
+
+   double VelocityUnit(const Param &param)
+   {
+      double v_unit = param.sim.year ? 1.0/86400/365.25 : 1.0;
+      if (param.bc.bc_unit == "cm/yr") { v_unit /= 100.0; }
+      else if (param.bc.bc_unit == "mm/yr") { v_unit /= 1000.0; }
+      else if (param.bc.bc_unit == "cm/s") { v_unit *= 0.01; }
+      return v_unit;
+   }
+
+   Mesh *MakeSerialMesh(const Param &param)
+   {
+      Mesh *mesh = nullptr;
+      if (param.mesh.mesh_file.compare("default") != 0)
+      {
+         mesh = new Mesh(param.mesh.mesh_file.c_str(), true, true);
+      }
+      else if (param.sim.dim == 1)
+      {
+         mesh = new Mesh(Mesh::MakeCartesian1D(2));
+         mesh->GetBdrElement(0)->SetAttribute(1);
+         mesh->GetBdrElement(1)->SetAttribute(1);
+      }
+      else if (param.sim.dim == 2)
+      {
+         mesh = new Mesh(Mesh::MakeCartesian2D(2, 2, Element::QUADRILATERAL,
+                                               true));
+         const int NBE = mesh->GetNBE();
+         for (int b = 0; b < NBE; b++)
+         {
+            mesh->GetBdrElement(b)->SetAttribute((b < NBE/2) ? 2 : 1);
+         }
+      }
+      else
+      {
+         mesh = new Mesh(Mesh::MakeCartesian3D(2, 2, 2, Element::HEXAHEDRON,
+                                               true));
+         const int NBE = mesh->GetNBE();
+         for (int b = 0; b < NBE; b++)
+         {
+            const int attr = (b < NBE/3) ? 3 : (b < 2*NBE/3) ? 1 : 2;
+            mesh->GetBdrElement(b)->SetAttribute(attr);
+         }
+      }
+
+      // Refine the mesh in serial to increase the resolution.
+      for (int lev = 0; lev < param.mesh.rs_levels; lev++)
+      {
+         mesh->UniformRefinement();
+      }
+
+      // Local refinement: once in materials 2 and up, once more in 3 and up.
+      if (param.mesh.local_refinement)
+      {
+         mesh->EnsureNCMesh(true);
+         Array<int> refs;
+         for (int min_attr = 2; min_attr <= 3; min_attr++)
+         {
+            for (int i = 0; i < mesh->GetNE(); i++)
+            {
+               if (mesh->GetAttribute(i) >= min_attr) { refs.Append(i); }
+            }
+            mesh->GeneralRefinement(refs, 1);
+            refs.DeleteAll();
+         }
+         mesh->Finalize(true);
+      }
+      return mesh;
+   }
+
+   ParMesh *MakeParMesh(MPI_Comm comm, Mesh &mesh, const Param &param)
+   {
+      int myid, num_tasks;
+      MPI_Comm_rank(comm, &myid);
+      MPI_Comm_size(comm, &num_tasks);
+      const int dim = mesh.Dimension();
+
+      int unit = 1;
+      int nxyz[3] = {1, 1, 1};
+      switch (param.mesh.partition_type)
+      {
+         case 0:
+            break;
+         case 11:
+         case 111:
+            unit = static_cast<int>(floor(pow(num_tasks, 1.0 / dim) + 1e-2));
+            for (int d = 0; d < dim; d++) { nxyz[d] = unit; }
+            break;
+         case 21: // 2D
+            unit = static_cast<int>(floor(pow(num_tasks / 2, 1.0 / 2) + 1e-2));
+            nxyz[0] = 2 * unit; nxyz[1] = unit;
+            break;
+         case 31: // 2D
+            unit = static_cast<int>(floor(pow(num_tasks / 3, 1.0 / 2) + 1e-2));
+            nxyz[0] = 3 * unit; nxyz[1] = unit;
+            break;
+         case 32: // 2D
+            unit = static_cast<int>(floor(pow(2 * num_tasks / 3, 1.0 / 2) + 1e-2));
+            nxyz[0] = 3 * unit / 2; nxyz[1] = unit;
+            break;
+         case 49: // 2D
+            unit = static_cast<int>(floor(pow(9 * num_tasks / 4, 1.0 / 2) + 1e-2));
+            nxyz[0] = 4 * unit / 9; nxyz[1] = unit;
+            break;
+         case 51: // 2D
+            unit = static_cast<int>(floor(pow(num_tasks / 5, 1.0 / 2) + 1e-2));
+            nxyz[0] = 5 * unit; nxyz[1] = unit;
+            break;
+         case 211: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 2, 1.0 / 3) + 1e-2));
+            nxyz[0] = 2 * unit; nxyz[1] = unit; nxyz[2] = unit;
+            break;
+         case 221: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 4, 1.0 / 3) + 1e-2));
+            nxyz[0] = 2 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
+            break;
+         case 311: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 3, 1.0 / 3) + 1e-2));
+            nxyz[0] = 3 * unit; nxyz[1] = unit; nxyz[2] = unit;
+            break;
+         case 321: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 6, 1.0 / 3) + 1e-2));
+            nxyz[0] = 3 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
+            break;
+         case 322: // 3D.
+            unit = static_cast<int>(floor(pow(2 * num_tasks / 3, 1.0 / 3) + 1e-2));
+            nxyz[0] = 3 * unit / 2; nxyz[1] = unit; nxyz[2] = unit;
+            break;
+         case 432: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 3, 1.0 / 3) + 1e-2));
+            nxyz[0] = 2 * unit; nxyz[1] = 3 * unit / 2; nxyz[2] = unit;
+            break;
+         case 511: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 5, 1.0 / 3) + 1e-2));
+            nxyz[0] = 5 * unit; nxyz[1] = unit; nxyz[2] = unit;
+            break;
+         case 521: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 10, 1.0 / 3) + 1e-2));
+            nxyz[0] = 5 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
+            break;
+         case 522: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 20, 1.0 / 3) + 1e-2));
+            nxyz[0] = 5 * unit; nxyz[1] = 2 * unit; nxyz[2] = 2 * unit;
+            break;
+         case 911: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 9, 1.0 / 3) + 1e-2));
+            nxyz[0] = 9 * unit; nxyz[1] = unit; nxyz[2] = unit;
+            break;
+         case 921: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 18, 1.0 / 3) + 1e-2));
+            nxyz[0] = 9 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
+            break;
+         case 922: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 36, 1.0 / 3) + 1e-2));
+            nxyz[0] = 9 * unit; nxyz[1] = 2 * unit; nxyz[2] = 2 * unit;
+            break;
+         default:
+            if (myid == 0)
+            {
+               std::cout << "Unknown partition type: "
+                         << param.mesh.partition_type << '\n';
+            }
+            return nullptr;
+      }
+
+      ParMesh *pmesh = nullptr;
+      int product = 1;
+      for (int d = 0; d < dim; d++) { product *= nxyz[d]; }
+      if (product == num_tasks)
+      {
+         int *partitioning = mesh.CartesianPartitioning(nxyz);
+         pmesh = new ParMesh(comm, mesh, partitioning);
+         delete [] partitioning;
+      }
+      else
+      {
+         if (myid == 0)
+         {
+            std::cout << "Non-Cartesian partitioning through METIS will be used.\n";
+#ifndef MFEM_USE_METIS
+            std::cout << "MFEM was built without METIS. "
+                      << "Adjust the number of tasks to use a Cartesian split."
+                      << std::endl;
+#endif
+         }
+#ifndef MFEM_USE_METIS
+         return nullptr;
+#endif
+         pmesh = new ParMesh(comm, mesh);
+      }
+
+      // Refine the mesh further in parallel to increase the resolution.
+      for (int lev = 0; lev < param.mesh.rp_levels; lev++)
+      {
+         pmesh->UniformRefinement();
+      }
+      return pmesh;
+   }
+
+   ODESolver *MakeODESolver(const int type)
+   {
+      switch (type)
+      {
+         case 1: return new ForwardEulerSolver;
+         case 2: return new RK2Solver(0.5);
+         case 3: return new RK3SSPSolver;
+         case 4: return new RK4Solver;
+         case 6: return new RK6Solver;
+         case 7: return new RK2AvgSolver;
+         default: return nullptr;
+      }
+   }
+
+   ConductionOperator::ConductionOperator(ParFiniteElementSpace &f, double al,
+                                          double kap, const Vector &u)
+      : TimeDependentOperator(f.GetTrueVSize(), 0.0), fespace(f), M(NULL),
+        K(NULL), T(NULL), current_dt(0.0),
+        M_solver(f.GetComm()), T_solver(f.GetComm()), z(height)
+   {
+      const double rel_tol = 1e-8;
+
+      M = new ParBilinearForm(&fespace);
+      M->AddDomainIntegrator(new MassIntegrator());
+      M->Assemble(0); // keep sparsity pattern of M and K the same
+      M->FormSystemMatrix(ess_tdof_list, Mmat);
+
+      M_solver.iterative_mode = false;
+      M_solver.SetRelTol(rel_tol);
+      M_solver.SetAbsTol(0.0);
+      M_solver.SetMaxIter(100);
+      M_solver.SetPrintLevel(0);
+      M_prec.SetType(HypreSmoother::Jacobi);
+      M_solver.SetPreconditioner(M_prec);
+      M_solver.SetOperator(Mmat);
+
+      alpha = al;
+      kappa = kap;
+
+      T_solver.iterative_mode = false;
+      T_solver.SetRelTol(rel_tol);
+      T_solver.SetAbsTol(0.0);
+      T_solver.SetMaxIter(100);
+      T_solver.SetPrintLevel(0);
+      T_solver.SetPreconditioner(T_prec);
+
+      SetParameters(u);
+   }
+
+   void ConductionOperator::Mult(const Vector &u, Vector &du_dt) const
+   {
+      // Compute:
+      //    du_dt = M^{-1}*-Ku
+      // for du_dt, where K is linearized by using u from the previous timestep
+      Kmat.Mult(u, z);
+      z.Neg(); // z = -z
+      M_solver.Mult(z, du_dt);
+   }
+
+   void ConductionOperator::ImplicitSolve(const double dt,
+                                          const Vector &u, Vector &du_dt)
+   {
+      // Solve the equation:
+      //    du_dt = M^{-1}*[-K(u + dt*du_dt)]
+      // for du_dt, where K is linearized by using u from the previous timestep
+      if (!T)
+      {
+         T = Add(1.0, Mmat, dt, Kmat);
+         current_dt = dt;
+         T_solver.SetOperator(*T);
+      }
+      MFEM_VERIFY(dt == current_dt, ""); // SDIRK methods use the same dt
+      Kmat.Mult(u, z);
+      z.Neg();
+      T_solver.Mult(z, du_dt);
+   }
+
+   void ConductionOperator::SetParameters(const Vector &u)
+   {
+      ParGridFunction u_alpha_gf(&fespace);
+      u_alpha_gf.SetFromTrueDofs(u);
+      for (int i = 0; i < u_alpha_gf.Size(); i++)
+      {
+         u_alpha_gf(i) = kappa + alpha*u_alpha_gf(i);
+      }
+
+      delete K;
+      K = new ParBilinearForm(&fespace);
+
+      GridFunctionCoefficient u_coeff(&u_alpha_gf);
+
+      K->AddDomainIntegrator(new DiffusionIntegrator(u_coeff));
+      K->Assemble(0); // keep sparsity pattern of M and K the same
+      K->FormSystemMatrix(ess_tdof_list, Kmat);
+      delete T;
+      T = NULL; // re-compute T on the next ImplicitSolve
+   }
+
+   ConductionOperator::~ConductionOperator()
+   {
+      delete T;
+      delete M;
+      delete K;
+   }
+
+   Simulation::Simulation(MPI_Comm comm_)
+      : comm(comm_), dim(0), pmesh(nullptr), max_vbc_val(0.0),
+        profile(nullptr), mem_ledger(nullptr), t(0.0), dt(0.0), dt_old(0.0),
+        dt_est(0.0), h_min(1.0), max_skew(0.0), min_vol(0.0), steps(0),
+        ode_steps(0)
+   {
+      MPI_Comm_rank(comm, &myid);
+   }
+
+   Simulation::~Simulation() { Clear(); }
+
+   void Simulation::Clear()
+   {
+      // Users first: the operator and the fields refer to the spaces, the
+      // spaces to the mesh.
+      dt_ctrl.reset();
+      ode_solver.reset();
+      geo.reset();
+      vbc.reset();
+      top_solver.reset(); bottom_solver.reset();
+      top_diff.reset(); bottom_diff.reset();
+      x_top.reset(); topo.reset(); x_bottom.reset(); bottom.reset();
+      top_fes.reset(); top_elev_fes.reset();
+      bottom_fes.reset(); bottom_elev_fes.reset();
+      top_mesh.reset(); bottom_mesh.reset();
+      rho0_gf.reset(); fictitious_rho0_gf.reset();
+      lambda0_gf.reset(); mu0_gf.reset(); mat_gf.reset(); comp_gf.reset();
+      comp_ref_gf.reset(); s_old_gf.reset(); p_gf.reset(); p_gf_old.reset();
+      p_init_gf.reset(); ini_p_gf.reset(); ini_p_old_gf.reset();
+      u_gf.reset(); x_ini_gf.reset(); x_old_gf.reset();
+      quality.reset(); vol_ini_gf.reset(); skew_ini_gf.reset();
+      S.reset(); S_old.reset(); S_init.reset();
+      L2FESpace.reset(); H1FESpace.reset(); L2FESpace_stress.reset();
+      L2FESpace_mat.reset(); l2_fes.reset(); mat_fes.reset(); xyz_fes.reset();
+      L2FESpace_geometric.reset();
+      L2FEC.reset(); H1FEC.reset(); l2_fec.reset(); mat_fec.reset();
+      delete pmesh;
+      pmesh = nullptr;
+   }
+
+   // The time unit conversions of the laghost driver. A step limit replaces
+   // the final time.
+   static Param ToSeconds(const Param &p)
+   {
+      Param param = p;
+      if (param.sim.max_tsteps > -1) { param.sim.t_final = 1.0e38; }
+      if (param.sim.year)
+      {
+         param.sim.t_final *= 86400 * 365.25;
+         param.bc.bc_ramp_time *= 86400 * 365.25;
+      }
+      return param;
+   }
+
+   void Simulation::Setup(const Param &p, Mesh *serial_mesh)
+   {
+      Clear();
+      param = ToSeconds(p);
+
+      Mesh *mesh = serial_mesh ? serial_mesh : MakeSerialMesh(param);
+      pmesh = MakeParMesh(comm, *mesh, param);
+      if (!serial_mesh) { delete mesh; }
+      MFEM_VERIFY(pmesh, "Cannot partition the mesh");
+      dim = pmesh->Dimension();
+      if (dim == 1) { param.solver.p_assembly = false; }
+
+      Vector bb_min, bb_max;
+      pmesh->GetBoundingBox(bb_min, bb_max, std::max(param.mesh.order_v, 1));
+      bb_center.SetSize(dim);
+      bb_length.SetSize(dim);
+      for (int d = 0; d < dim; d++)
+      {
+         bb_center[d] = (bb_min[d] + bb_max[d])*0.5;
+         bb_length[d] = bb_max[d] - bb_min[d];
+      }
+
+      // H1 position and velocity, L2 (closed basis) energy and stress, and
+      // positive-basis L2 spaces for interpolated initial fields. The mesh
+      // quality has size, aspect ratio and skewness parameters.
+      const int order_e = param.mesh.order_e;
+      const int nquality = (dim == 3) ? 6 : 3;
+      L2FEC.reset(new L2_FECollection(order_e, dim, BasisType::GaussLobatto));
+      H1FEC.reset(new H1_FECollection(param.mesh.order_v, dim));
+      l2_fec.reset(new L2_FECollection(order_e, dim, BasisType::Positive));
+      mat_fec.reset(new L2_FECollection(order_e, dim));
+      L2FESpace.reset(new ParFiniteElementSpace(pmesh, L2FEC.get()));
+      H1FESpace.reset(new ParFiniteElementSpace(pmesh, H1FEC.get(), dim));
+      L2FESpace_stress.reset(new ParFiniteElementSpace(pmesh, L2FEC.get(),
+                                                       3*(dim-1)));
+      L2FESpace_mat.reset(new ParFiniteElementSpace(pmesh, L2FEC.get(),
+                                                    pmesh->attributes.Max()));
+      L2FESpace_geometric.reset(new ParFiniteElementSpace(pmesh, L2FEC.get(),
+                                                          nquality));
+      l2_fes.reset(new ParFiniteElementSpace(pmesh, l2_fec.get()));
+      mat_fes.reset(new ParFiniteElementSpace(pmesh, mat_fec.get()));
+      xyz_fes.reset(new ParFiniteElementSpace(pmesh, l2_fec.get(), dim));
+
+      // State: position, velocity, specific internal energy, stress.
+      const int Vsize_l2 = L2FESpace->GetVSize();
+      const int Vsize_h1 = H1FESpace->GetVSize();
+      offset.SetSize(5);
+      offset[0] = 0;
+      offset[1] = offset[0] + Vsize_h1;
+      offset[2] = offset[1] + Vsize_h1;
+      offset[3] = offset[2] + Vsize_l2;
+      offset[4] = offset[3] + Vsize_l2*3*(dim-1);
+      S.reset(new BlockVector(offset, Device::GetMemoryType()));
+      x_gf.MakeRef(H1FESpace.get(), *S, offset[0]);
+      v_gf.MakeRef(H1FESpace.get(), *S, offset[1]);
+      e_gf.MakeRef(L2FESpace.get(), *S, offset[2]);
+      s_gf.MakeRef(L2FESpace_stress.get(), *S, offset[3]);
+      pmesh->SetNodalGridFunction(&x_gf);
+      x_gf.SyncAliasMemory(*S);
+
+      rho0_gf.reset(new ParGridFunction(L2FESpace.get()));
+      fictitious_rho0_gf.reset(new ParGridFunction(L2FESpace.get()));
+      lambda0_gf.reset(new ParGridFunction(mat_fes.get()));
+      mu0_gf.reset(new ParGridFunction(mat_fes.get()));
+      mat_gf.reset(new ParGridFunction(mat_fes.get()));
+      comp_gf.reset(new ParGridFunction(L2FESpace_mat.get()));
+      comp_ref_gf.reset(new ParGridFunction(L2FESpace_mat.get()));
+      s_old_gf.reset(new ParGridFunction(L2FESpace_stress.get()));
+      p_gf.reset(new ParGridFunction(L2FESpace.get()));
+      p_gf_old.reset(new ParGridFunction(L2FESpace.get()));
+      p_init_gf.reset(new ParGridFunction(L2FESpace.get()));
+      ini_p_gf.reset(new ParGridFunction(L2FESpace.get()));
+      ini_p_old_gf.reset(new ParGridFunction(L2FESpace.get()));
+      u_gf.reset(new ParGridFunction(H1FESpace.get()));
+      x_ini_gf.reset(new ParGridFunction(H1FESpace.get()));
+      x_old_gf.reset(new ParGridFunction(H1FESpace.get()));
+      quality.reset(new ParGridFunction(L2FESpace_geometric.get()));
+      vol_ini_gf.reset(new ParGridFunction(L2FESpace.get()));
+      skew_ini_gf.reset(new ParGridFunction(L2FESpace.get()));
+
+      SetBoundaryConditions();
+      SetMaterials();
+      SetInitialFields();
+      SetSurfaces();
+
+      geo.reset(new geodynamics::LagrangianGeoOperator(
+                   S->Size(), *H1FESpace, *L2FESpace, *L2FESpace_stress,
+                   ess_tdofs, *rho0_gf, *fictitious_rho0_gf, *mat_gf, 0,
+                   param.solver.cfl, param.solver.impose_visc, false,
+                   param.solver.p_assembly, param.solver.cg_tol,
+                   param.solver.cg_max_iter, param.solver.ftz_tol,
+                   param.mesh.order_q, *lambda0_gf, *mu0_gf,
+                   param.control.mscale, param.control.gravity,
+                   param.control.thickness, param.control.winkler_foundation,
+                   param.control.winkler_rho, param.control.dyn_damping,
+                   param.control.dyn_factor, bc_id_pa, max_vbc_val,
+                   param.solver.force_ea));
+      if (param.control.selective_mscale)
+      {
+         // The velocity mass operators are rebuilt with the element factors.
+         geo->SetSelectiveMassScaling(true, param.control.smscale_h,
+                                      param.control.smscale_max_added);
+         geo->TMOPUpdate(*S, false);
+      }
+      ode_solver.reset(MakeODESolver(param.solver.ode_solver_type));
+      MFEM_VERIFY(ode_solver, "Unknown ODE solver type: "
+                  << param.solver.ode_solver_type);
+
+      S_old.reset(new BlockVector(*S));
+      S_init.reset(new BlockVector(*S));
+      *p_init_gf = *p_gf;
+      StartTimeStepping();
+   }
+
+   void Simulation::SetBoundaryConditions()
+   {
+      bc_id = ParseList<int>(param.bc.bc_ids);
+      const int nbdr = pmesh->bdr_attributes.Max();
+      MFEM_VERIFY((int) bc_id.size() == nbdr,
+                  "The number of boundaries are not consistent with the given "
+                  "mesh. BC indicator from mesh is " << nbdr
+                  << " but input is " << bc_id.size());
+      for (const int id : bc_id)
+      {
+         MFEM_VERIFY(id <= 0 || VelocityBC::ComponentMask(dim, id) != 0,
+                     "Unknown boundary type: " << id);
+      }
+      vbc.reset(new VelocityBC(*H1FESpace, bc_id,
+                               ParseList<double>(param.bc.bc_vxs),
+                               ParseList<double>(param.bc.bc_vys),
+                               ParseList<double>(param.bc.bc_vzs),
+                               VelocityUnit(param)));
+      ess_tdofs = vbc->GetEssentialTrueDofs();
+      bc_id_pa.SetSize(nbdr);
+      for (int i = 0; i < nbdr; i++) { bc_id_pa[i] = bc_id[i]; }
+
+      // Lower limit of 0.1 mm/yr, to prevent infinite mass scaling.
+      max_vbc_val = std::max(1.0/10000/86400/365.25, vbc->MaxSpeed());
+   }
+
+   void Simulation::SetMaterials()
+   {
+      const int nmat = pmesh->attributes.Max();
+      auto values = [&](const std::string &name, const std::string &list,
+                        Vector &v)
+      {
+         MFEM_VERIFY(MaterialValues(ParseList<double>(list), nmat, v),
+                     "The number of " << name << " are not consistent with "
+                     "material ID in the given mesh.");
+      };
+      values("rho", param.mat.rho, z_rho);
+      values("lambda", param.mat.lambda, lambda);
+      values("mu", param.mat.mu, mu);
+      values("tension_cutoff", param.mat.tension_cutoff, tension_cutoff);
+      values("cohesion0", param.mat.cohesion0, cohesion0);
+      values("cohesion1", param.mat.cohesion1, cohesion1);
+      values("friction_angle0", param.mat.friction_angle0, friction_angle0);
+      values("friction_angle1", param.mat.friction_angle1, friction_angle1);
+      values("dilation_angle0", param.mat.dilation_angle0, dilation_angle0);
+      values("dilation_angle1", param.mat.dilation_angle1, dilation_angle1);
+      values("pls0", param.mat.pls0, pls0);
+      values("pls1", param.mat.pls1, pls1);
+      if (param.mat.viscoplastic)
+      {
+         values("plastic_viscosity", param.mat.plastic_viscosity,
+                plastic_viscosity);
+      }
+      else
+      {
+         plastic_viscosity.SetSize(nmat);
+         plastic_viscosity = 1.0e+300;
+      }
+
+      // Fictitious density of the mass scaling; with a single density, the
+      // stiffness of the first material is used everywhere.
+      const double pseudo_speed = max_vbc_val * param.control.mscale;
+      const bool single = ParseList<double>(param.mat.rho).size() == 1;
+      s_rho.SetSize(nmat);
+      for (int i = 0; i < nmat; i++)
+      {
+         const int k = single ? 0 : i;
+         s_rho[i] = (lambda[k] + 2*mu[k]) / (pseudo_speed * pseudo_speed);
+      }
+
+      ProjectPWConstL2(z_rho, *rho0_gf);
+      ProjectPWConstL2(s_rho, *fictitious_rho0_gf);
+      ProjectPWConstL2(lambda, *lambda0_gf);
+      ProjectPWConstL2(mu, *mu0_gf);
+      Vector mat(nmat);
+      for (int i = 0; i < nmat; i++) { mat[i] = i; }
+      ProjectPWConstL2(mat, *mat_gf);
+      ProjectMaterialIndicators(*comp_gf);
+   }
+
+   void Simulation::SetInitialFields()
+   {
+      VectorFunctionCoefficient v_coeff(dim, v0);
+      v_gf.ProjectCoefficient(v_coeff);
+      vbc->Apply(v_gf, VelocityBC::RampScale(0.0, param.bc.bc_ramp_time));
+      v_gf.SyncAliasMemory(*S);
+
+      ParGridFunction l2_e(l2_fes.get());
+      FunctionCoefficient e_coeff(e0);
+      l2_e.ProjectCoefficient(e_coeff);
+      e_gf.ProjectGridFunction(l2_e);
+      e_gf.SyncAliasMemory(*S);
+
+      ProjectInitialStress(z_rho, param.control.gravity,
+                           param.control.thickness, param.control.lithostatic,
+                           s_gf);
+      s_gf.SyncAliasMemory(*S);
+
+      // Initial plastic strain in the weak zone.
+      ParGridFunction xyz_gf_l2(xyz_fes.get());
+      VectorFunctionCoefficient xyz_coeff(dim, xyz0);
+      xyz_gf_l2.ProjectCoefficient(xyz_coeff);
+      Vector weak_location(dim);
+      weak_location[0] = param.mat.weak_x;
+      weak_location[1] = param.mat.weak_y;
+      if (dim == 3) { weak_location[2] = param.mat.weak_z; }
+      PlasticCoefficient p_coeff(dim, xyz_gf_l2, weak_location,
+                                 param.mat.weak_rad, param.mat.ini_pls);
+      ParGridFunction l2_p_gf(l2_fes.get());
+      l2_p_gf.ProjectCoefficient(p_coeff);
+      p_gf->ProjectGridFunction(l2_p_gf);
+
+      *u_gf = 0.0;
+   }
+
+   void Simulation::SetSurfaces()
+   {
+      top_solver.reset(); bottom_solver.reset();
+      top_diff.reset(); bottom_diff.reset();
+      x_top.reset(); topo.reset(); x_bottom.reset(); bottom.reset();
+      top_fes.reset(); top_elev_fes.reset();
+      bottom_fes.reset(); bottom_elev_fes.reset();
+      top_mesh.reset(); bottom_mesh.reset();
+      if (dim == 1) { return; }
+
+      // Submesh nodes and the elevation, the second coordinate.
+      auto make_surface = [&](const int attr,
+                              std::unique_ptr<ParSubMesh> &smesh,
+                              std::unique_ptr<ParFiniteElementSpace> &fes,
+                              std::unique_ptr<ParFiniteElementSpace> &elev_fes,
+                              std::unique_ptr<ParGridFunction> &x_s,
+                              std::unique_ptr<ParGridFunction> &elev)
+      {
+         Array<int> bdr_attrs(1);
+         bdr_attrs[0] = attr;
+         smesh.reset(new ParSubMesh(
+                        ParSubMesh::CreateFromBoundary(*pmesh, bdr_attrs)));
+         fes.reset(new ParFiniteElementSpace(smesh.get(), H1FEC.get(), dim));
+         elev_fes.reset(new ParFiniteElementSpace(smesh.get(), H1FEC.get()));
+         x_s.reset(new ParGridFunction(fes.get()));
+         elev.reset(new ParGridFunction(elev_fes.get()));
+         smesh->SetNodalGridFunction(x_s.get());
+         const int n = elev->Size();
+         for (int i = 0; i < n; i++) { (*elev)[i] = (*x_s)[i + n]; }
+      };
+      make_surface(4, top_mesh, top_fes, top_elev_fes, x_top, topo);
+      make_surface(3, bottom_mesh, bottom_fes, bottom_elev_fes, x_bottom,
+                   bottom);
+
+      // Explicit midpoint steps of the surface and bottom diffusion.
+      Vector elev_t;
+      topo->GetTrueDofs(elev_t);
+      top_diff.reset(new ConductionOperator(*top_elev_fes, 0.0,
+                                            param.control.surf_diff, elev_t));
+      bottom->GetTrueDofs(elev_t);
+      bottom_diff.reset(new ConductionOperator(*bottom_elev_fes, 0.0,
+                                               param.control.bott_diff,
+                                               elev_t));
+      top_solver.reset(new RK2Solver(0.5));
+      bottom_solver.reset(new RK2Solver(0.5));
+   }
+
+   void Simulation::StartTimeStepping()
+   {
+      t = 0.0;
+      dt_old = 0.0;
+      steps = 0;
+      ode_steps = 0;
+      *s_old_gf = s_gf;
+      *p_gf_old = *p_gf;
+      *ini_p_gf = *p_gf;
+      *ini_p_old_gf = *p_gf;
+      *x_ini_gf = x_gf;
+      *x_old_gf = x_gf;
+      *comp_ref_gf = *comp_gf;
+      UpdateMeshQuality(true);
+      for (int i = 0; i < vol_ini_gf->Size(); i++)
+      {
+         (*vol_ini_gf)[i] = (*quality)[i];
+      }
+      ode_solver->Init(*geo);
+      if (top_solver)
+      {
+         top_solver->Init(*top_diff);
+         bottom_solver->Init(*bottom_diff);
+      }
+      geo->ResetTimeStepEstimate();
+      dt_ctrl.reset(new TimeStepController(param.solver.dt_safety,
+                                           param.solver.dt_growth,
+                                           param.solver.dt_retry_factor,
+                                           param.solver.dt_max_retries));
+      geo->GetStepEstimates(*S, dt_est, h_min);
+      dt = dt_ctrl->Initial(param.control.init_dt, dt_est);
+   }
+
+   void Simulation::UpdateMeshQuality(const bool reference)
+   {
+      if (dim == 1) { return; }
+      const int nAspr = (dim == 3) ? 2 : 1, nSkew = (dim == 3) ? 3 : 1;
+      DenseMatrix jacobian(dim);
+      Array<int> vdofs;
+      Vector vals, aspr, skew, ori;
+      for (int e = 0; e < pmesh->GetNE(); e++)
+      {
+         const IntegrationRule &ir = L2FESpace_geometric->GetFE(e)->GetNodes();
+         const int nq = ir.GetNPoints();
+         L2FESpace_geometric->GetElementVDofs(e, vdofs);
+         vals.SetSize(vdofs.Size());
+         for (int q = 0; q < nq; q++)
+         {
+            pmesh->GetElementJacobian(e, jacobian, &ir.IntPoint(q));
+            double size;
+            pmesh->GetGeometricParametersFromJacobian(jacobian, size, aspr,
+                                                     skew, ori);
+            vals(q) = size;
+            for (int n = 0; n < nAspr; n++)
+            {
+               vals(q + (n+1)*nq) = (aspr(n) > 1.0) ? aspr(n) : 1.0/aspr(n);
+            }
+            for (int n = 0; n < nSkew; n++)
+            {
+               vals(q + (n+1+nAspr)*nq) = skew(n);
+            }
+         }
+         quality->SetSubVector(vdofs, vals);
+      }
+
+      // Minimum nodal volume and the largest change of the aspect ratio.
+      const int n = skew_ini_gf->Size();
+      double loc[2] = {std::numeric_limits<double>::max(), 0.0};
+      for (int i = 0; i < n; i++)
+      {
+         const double aspect = (*quality)[n + i];
+         if (reference) { (*skew_ini_gf)[i] = aspect; }
+         loc[0] = std::min(loc[0], (*quality)[i]);
+         loc[1] = std::max(loc[1], std::fabs(aspect - (*skew_ini_gf)[i]));
+      }
+      MPI_Allreduce(&loc[0], &min_vol, 1, MPI_DOUBLE, MPI_MIN, comm);
+      MPI_Allreduce(&loc[1], &max_skew, 1, MPI_DOUBLE, MPI_MAX, comm);
+   }
+
+   void Simulation::Abort(const int step, const char *msg)
+   {
+      if (abort_hook) { abort_hook(step); }
+      MFEM_ABORT(msg);
+   }
+
+   void Simulation::DiffuseSurfaces()
+   {
+      if (!top_solver) { return; }
+
+      // One diffusion step of the elevation of a boundary submesh, moving
+      // its nodes in the mesh; flat keeps the boundary at zero elevation.
+      auto diffuse = [&](ParSubMesh &smesh, ParGridFunction &x_s,
+                         ParGridFunction &elev, ODESolver &solver,
+                         const bool flat)
+      {
+         ParSubMesh::Transfer(x_gf, x_s);
+         const int n = elev.Size();
+         for (int i = 0; i < n; i++) { elev[i] = x_s[i + n]; }
+         Vector elev_t;
+         elev.GetTrueDofs(elev_t);
+         solver.Step(elev_t, t, dt);
+         t = t - dt;
+         elev.SetFromTrueDofs(elev_t);
+         for (int i = 0; i < n; i++) { x_s[i + n] = flat ? 0.0 : elev[i]; }
+         smesh.NewNodes(x_s, false);
+         ParSubMesh::Transfer(x_s, x_gf);
+      };
+      if (param.control.surf_proc)
+      {
+         diffuse(*top_mesh, *x_top, *topo, *top_solver, false);
+      }
+      if (param.control.winkler_foundation && param.control.bott_proc)
+      {
+         diffuse(*bottom_mesh, *x_bottom, *bottom, *bottom_solver,
+                 param.control.winkler_flat);
+      }
+   }
+
+   void Simulation::ReturnMapping()
+   {
+      if (!param.mat.plastic) { return; }
+      if (profile) { profile->Begin("rheology"); }
+      if (dim == 2)
+      {
+         Returnmapping2d(*comp_gf, s_gf, *s_old_gf, *p_gf, *mat_gf, dim,
+                         h_min, z_rho, lambda, mu, tension_cutoff,
+                         cohesion0, cohesion1, pls0, pls1,
+                         friction_angle0, friction_angle1,
+                         dilation_angle0, dilation_angle1,
+                         plastic_viscosity, param.mat.viscoplastic, dt_old);
+      }
+      else
+      {
+         Returnmapping3d(*comp_gf, s_gf, *s_old_gf, *p_gf, *mat_gf, dim,
+                         h_min, z_rho, lambda, mu, tension_cutoff,
+                         cohesion0, cohesion1, pls0, pls1,
+                         friction_angle0, friction_angle1,
+                         dilation_angle0, dilation_angle1,
+                         plastic_viscosity, param.mat.viscoplastic, dt_old);
+      }
+      if (profile)
+      {
+         profile->End("rheology");
+         // Points that yielded in this step.
+         long yielded = 0;
+         for (int i = 0; i < p_gf->Size(); i++)
+         {
+            if ((*p_gf)[i] > (*p_gf_old)[i]) { yielded++; }
+         }
+         profile->AddPlasticPoints(yielded);
+      }
+   }
+
+   int Simulation::Advance(const int n_steps)
+   {
+      int taken = 0;
+      while (taken < n_steps && !Done())
+      {
+         const int ti = steps + 1;
+         if (t + dt >= param.sim.t_final) { dt = param.sim.t_final - t; }
+         *S_old = *S;
+         const double t_old = t;
+         *p_gf_old = *p_gf;
+         *ini_p_old_gf = *ini_p_gf;
+         *x_old_gf = x_gf;
+         geo->ResetTimeStepEstimate();
+
+         if (param.control.pseudo_transient)
+         {
+            // Iterations on the mesh and the stress of the step start.
+            for (int i = 0; i < param.control.transient_num; i++)
+            {
+               x_gf = *x_old_gf;
+               s_gf = *s_old_gf;
+               ode_solver->Step(*S, t, dt);
+            }
+            t = t - dt*(param.control.transient_num - 1.0);
+         }
+         else
+         {
+            ode_solver->Step(*S, t, dt);
+         }
+         DiffuseSurfaces();
+         ReturnMapping();
+         ode_steps++;
+         dt_old = dt;
+
+         geo->GetStepEstimates(*S, dt_est, h_min);
+         const bool remeshed = remesh_hook && remesh_hook(ti);
+         if (!remeshed)
+         {
+            if (!dt_ctrl->Accept(dt, dt_est))
+            {
+               // Repeat with a smaller dt: a drop of the estimate suggests
+               // oscillations, a zero estimate an inverted element.
+               dt = dt_ctrl->Reject(dt, dt_est);
+               if (param.solver.dt_log && myid == 0)
+               {
+                  std::cout << "dt control: step " << ti
+                            << " rejected, retry with dt " << dt << " ("
+                            << dt_ctrl->Limiter() << ")" << std::endl;
+               }
+               if (dt < 1.0E-38)
+               {
+                  Abort(ti, (dt_ctrl->Limiter() == "inverted")
+                        ? "Negative Jacobian (volume) occurs!"
+                        : "The time step crashed!");
+               }
+               t = t_old;
+               *S = *S_old;
+               *p_gf = *p_gf_old;
+               *ini_p_gf = *ini_p_old_gf;
+               geo->ResetQuadratureData();
+               continue;
+            }
+            dt = dt_ctrl->Next(dt, dt_est);
+         }
+         if (param.solver.dt_log && myid == 0)
+         {
+            std::cout << "dt control: step " << ti << ", dt " << dt_old
+                      << " -> " << dt << ", estimate " << dt_est << " ("
+                      << dt_ctrl->Limiter() << ")" << std::endl;
+         }
+
+         x_gf.SyncAliasMemory(*S);
+         v_gf.SyncAliasMemory(*S);
+         e_gf.SyncAliasMemory(*S);
+         s_gf.SyncAliasMemory(*S);
+         if (param.bc.bc_ramp_time > 0.0)
+         {
+            vbc->Apply(v_gf, VelocityBC::RampScale(t, param.bc.bc_ramp_time));
+            v_gf.SyncAliasMemory(*S);
+         }
+         *s_old_gf = s_gf;
+         u_gf->Add(dt_old, v_gf);
+
+         UpdateMeshQuality(false);
+         if (dim > 1 && min_vol < 0.0)
+         {
+            // Inverted element: repeat the step with a smaller dt, unless
+            // the mesh was just remeshed.
+            const double dt_retry = dt_ctrl->Inverted(dt_old);
+            if (remeshed || dt_retry == 0.0)
+            {
+               Abort(ti, "Negative Jacobian (volume) occurs!");
+            }
+            if (param.solver.dt_log && myid == 0)
+            {
+               std::cout << "dt control: step " << ti << " inverted an "
+                         << "element, retry with dt " << dt_retry
+                         << std::endl;
+            }
+            u_gf->Add(-dt_old, v_gf);
+            dt = dt_retry;
+            t = t_old;
+            *S = *S_old;
+            *p_gf = *p_gf_old;
+            *ini_p_gf = *ini_p_old_gf;
+            *s_old_gf = s_gf;
+            geo->ResetQuadratureData();
+            continue;
+         }
+         dt_ctrl->Completed();
+
+         // Mass matrices and densities on the moved mesh.
+         if (mem_ledger) { mem_ledger->BeginPhase("operator update"); }
+         if (remeshed && param.control.selective_mscale)
+         {
+            geo->ComputeMassScaling();
+         }
+         geo->TMOPUpdate(*S, param.tmop.tmop && param.control.mass_bal &&
+                         ti > 1);
+         if (mem_ledger) { mem_ledger->EndPhase("operator update"); }
+
+         steps = ti;
+         taken++;
+         if (output_hook) { output_hook(ti, Done()); }
+      }
+      return taken;
+   }
+
+   void Simulation::Remesh(const bool initial)
+   {
+      MFEM_VERIFY(top_mesh, "Remeshing needs a 2D or 3D mesh");
+      ParGridFunction &x_old = *x_old_gf;
+
+      // Composition corrected for the volume change since the start.
+      CompMassCoefficient CompBalance(pmesh->attributes.Max(), *comp_ref_gf,
+                                      *vol_ini_gf, *quality);
+      comp_gf->ProjectCoefficient(CompBalance);
+      ParGridFunction x_mod_gf(H1FESpace.get());
+      // Store source mesh positions.
+      ParMesh *pmesh_copy = new ParMesh(*pmesh);
+      ParMesh *pmesh_copy_old = new ParMesh(*pmesh);
+      ParMesh *pmesh_old = new ParMesh(*pmesh);
+
+      x_old = *pmesh->GetNodes();
+
+      // The reference mesh stretched to the current bounding box.
+      Vector bb_min2, bb_max2;
+      pmesh->GetBoundingBox(bb_min2, bb_max2,
+                            std::max(param.mesh.order_v, 1));
+      Vector stretching_factor(dim);
+      for (int d = 0; d < dim; d++)
+      {
+         stretching_factor[d] = (bb_max2[d] - bb_min2[d])/bb_length[d];
+      }
+      if (myid == 0)
+      {
+         std::cout << "streching factor x: " << stretching_factor[0]
+                   << ", streching factor y:" << stretching_factor[1]
+                   << std::endl;
+      }
+      x_mod_gf = *x_ini_gf;
+      const int nnodes = x_mod_gf.Size()/dim;
+      for (int d = 0; d < dim; d++)
+      {
+         const double center2 = (bb_min2[d] + bb_max2[d])*0.5;
+         for (int i = 0; i < nnodes; i++)
+         {
+            double &x = x_mod_gf[i + d*nnodes];
+            x = (x - bb_center[d])*stretching_factor[d] + center2;
+         }
+      }
+
+      // Projecting top and bottom boundaries on flat surfaces.
+      const double global_max_top = bb_max2[1];
+      const double global_min_bot = bb_min2[1];
+      auto flatten = [&](ParGridFunction &x)
+      {
+         ParSubMesh::Transfer(x, *x_top);
+         const int nt = topo->Size();
+         for (int i = 0; i < nt; i++) { (*x_top)[i + nt] = global_max_top; }
+         ParSubMesh::Transfer(*x_top, x);
+
+         ParSubMesh::Transfer(x, *x_bottom);
+         if (param.control.winkler_foundation)
+         {
+            const int nb = bottom->Size();
+            for (int i = 0; i < nb; i++)
+            {
+               (*x_bottom)[i + nb] = global_min_bot;
+            }
+            ParSubMesh::Transfer(*x_bottom, x);
+         }
+      };
+      flatten(x_mod_gf);
+      x_gf = x_old;
+      flatten(x_gf);
+
+      pmesh_copy->NewNodes(x_mod_gf, false); // Deformed mesh for H1 interpolation
+      pmesh_copy_old->NewNodes(x_gf, false);
+
+      // Boundary nodes of the target mesh on the current boundary.
+      auto interpolate_boundary = [&]()
+      {
+         Vector vxyz = *pmesh_copy->GetNodes(); // from target mesh
+         const int point_ordering =
+            pmesh_copy->GetNodes()->FESpace()->GetOrdering();
+         FindPointsGSLIB finder(comm);
+         finder.Setup(*pmesh_copy_old); // source mesh
+         Vector interp_vals(x_gf.Size());
+         finder.Interpolate(vxyz, x_old, interp_vals, point_ordering);
+         x_mod_gf = interp_vals;
+         x_gf = x_old; // back to original gridfunction
+
+         // transfer interpolate coord to submesh
+         ParSubMesh::Transfer(x_mod_gf, *x_top);
+         ParSubMesh::Transfer(x_mod_gf, *x_bottom);
+         // transfer interpolate coord in submesh to original mesh
+         ParSubMesh::Transfer(*x_top, x_gf);
+         ParSubMesh::Transfer(*x_bottom, x_gf);
+         pmesh_copy->NewNodes(x_gf, false);
+      };
+      interpolate_boundary();
+
+      auto optimize = [&]()
+      {
+         HR_adaptivity(pmesh_copy, x_mod_gf, ess_tdofs, myid,
+                       param.tmop.mesh_poly_deg, param.mesh.rs_levels,
+                       param.mesh.rp_levels, param.tmop.jitter,
+                       param.tmop.metric_id, param.tmop.target_id,
+                       param.tmop.lim_const, param.tmop.adapt_lim_const,
+                       param.tmop.quad_type, param.tmop.quad_order,
+                       param.tmop.solver_type, param.tmop.solver_iter,
+                       param.tmop.solver_rtol, param.tmop.solver_art_type,
+                       param.tmop.lin_solver, param.tmop.max_lin_iter,
+                       param.tmop.move_bnd, param.tmop.combomet,
+                       param.tmop.bal_expl_combo, param.tmop.hradaptivity,
+                       param.tmop.h_metric_id, param.tmop.normalization,
+                       param.tmop.verbosity_level, param.tmop.fdscheme,
+                       param.tmop.adapt_eval, param.tmop.exactaction,
+                       param.solver.p_assembly, param.tmop.n_hr_iter,
+                       param.tmop.n_h_iter, param.tmop.mesh_node_ordering,
+                       param.tmop.barrier_type, param.tmop.worst_case_type,
+                       p_gf.get(), param.tmop.shear_pls,
+                       param.tmop.shear_width, param.tmop.shear_size_ratio);
+      };
+      if (myid == 0) { std::cout << "First Remeshing " << std::endl; }
+      optimize();
+
+      if (param.tmop.move_bnd)
+      {
+         // Second pass with fixed boundaries, from the moved ones.
+         interpolate_boundary();
+         param.tmop.move_bnd = false;
+         if (myid == 0) { std::cout << "Second Remeshing " << std::endl; }
+         optimize();
+         param.tmop.move_bnd = true;
+      }
+
+      x_gf = *pmesh_copy->GetNodes();
+      x_gf *= param.tmop.ale;
+      x_gf.Add(1.0 - param.tmop.ale, x_old);
+      pmesh->NewNodes(x_gf, false);
+      pmesh_copy->NewNodes(x_gf, false); // Deformed mesh for H1 interpolation
+      {
+         ParGridFunction U(H1FESpace.get());
+         U = x_old;
+         const int ns = 3*(dim-1);
+         Array<ParGridFunction *> sc(ns);
+         for (int c = 0; c < ns; c++)
+         {
+            sc[c] = new ParGridFunction(L2FESpace.get());
+            *sc[c] = 0.0;
+         }
+         ParGridFunction comps(L2FESpace.get()); comps = 0.0;
+         // Remapped unit field, to prevent mass leaking or adding.
+         ParGridFunction rmass(L2FESpace.get()); rmass = 1.0;
+         const int nmat = pmesh->attributes.Max();
+         const int nl2 = comps.Size();
+
+         for (int c = 0; c < ns; c++)
+         {
+            for (int i = 0; i < nl2; i++) { (*sc[c])[i] = s_gf[i + nl2*c]; }
+         }
+
+         // One remap from the source mesh, which the remap consumes.
+         auto remap = [&](ParGridFunction &gf)
+         {
+            ParMesh *pmesh_old1 = new ParMesh(*pmesh_old);
+            Remapping(pmesh_old1, U, x_gf, gf, param.mesh.order_v,
+                      param.mesh.order_e, param.solver.p_assembly,
+                      param.mesh.local_refinement);
+            delete pmesh_old1;
+            U = x_old;
+         };
+
+         if (myid == 0) { std::cout << "remapping for L2" << std::endl; }
+
+         if (param.tmop.remap_product)
+         {
+            // Synchronized product remap: rmass is transported once and
+            // every intensive field rides along as rmass*field in the
+            // same operator pass. The fields come back as ratios, so
+            // the division by rmass below is skipped.
+            Array<ParGridFunction *> prod_gfs;
+            Array<ParGridFunction *> comp_parts(nmat);
+            for (int i = 0; i < nmat; i++)
+            {
+               comp_parts[i] = new ParGridFunction(L2FESpace.get());
+               for (int j = 0; j < nl2; j++)
+               {
+                  (*comp_parts[i])[j] = (*comp_gf)[j + nl2*i];
+               }
+               prod_gfs.Append(comp_parts[i]);
+            }
+            prod_gfs.Append(&e_gf); prod_gfs.Append(p_gf.get());
+            prod_gfs.Append(ini_p_gf.get());
+            prod_gfs.Append(rho0_gf.get());
+            prod_gfs.Append(fictitious_rho0_gf.get());
+            for (int c = 0; c < ns; c++) { prod_gfs.Append(sc[c]); }
+
+            ParMesh *pmesh_old1 = new ParMesh(*pmesh_old);
+            Remapping(pmesh_old1, U, x_gf, rmass, prod_gfs,
+                      param.mesh.order_v, param.mesh.order_e,
+                      param.solver.p_assembly, param.mesh.local_refinement);
+            delete pmesh_old1;
+            U = x_old;
+
+            for (int i = 0; i < nmat; i++)
+            {
+               for (int j = 0; j < nl2; j++)
+               {
+                  (*comp_gf)[j + nl2*i] = (*comp_parts[i])[j];
+               }
+               delete comp_parts[i];
+            }
+         }
+         else
+         {
+            remap(rmass);
+            for (int i = 0; i < nmat; i++)
+            {
+               for (int j = 0; j < nl2; j++) { comps[j] = (*comp_gf)[j + nl2*i]; }
+               remap(comps);
+               for (int j = 0; j < nl2; j++)
+               {
+                  (*comp_gf)[j + nl2*i] = comps[j]/rmass[j];
+               }
+               comps = 0.0;
+            }
+            remap(e_gf);
+            remap(*p_gf);
+            remap(*ini_p_gf);
+            remap(*rho0_gf);
+            remap(*fictitious_rho0_gf);
+            for (int c = 0; c < ns; c++) { remap(*sc[c]); }
+         }
+
+         *lambda0_gf = 0.0; *mu0_gf = 0.0;
+         for (int j = 0; j < nl2; j++)
+         {
+            double all_comp = 0.0;
+            for (int i = 0; i < nmat; i++)
+            {
+               all_comp += (*comp_gf)[j + nl2*i];
+            }
+            if (!param.tmop.remap_product)
+            {
+               e_gf[j] /= rmass[j];
+               (*p_gf)[j] /= rmass[j];
+               (*ini_p_gf)[j] /= rmass[j];
+               (*rho0_gf)[j] /= rmass[j];
+               (*fictitious_rho0_gf)[j] /= rmass[j];
+               for (int c = 0; c < ns; c++) { (*sc[c])[j] /= rmass[j]; }
+            }
+            for (int i = 0; i < nmat; i++)
+            {
+               (*comp_gf)[j + nl2*i] /= all_comp;
+               (*lambda0_gf)[j] += lambda[i]*(*comp_gf)[j + nl2*i];
+               (*mu0_gf)[j] += mu[i]*(*comp_gf)[j + nl2*i];
+            }
+            for (int c = 0; c < ns; c++) { s_gf[j + nl2*c] = (*sc[c])[j]; }
+         }
+         for (int c = 0; c < ns; c++) { delete sc[c]; }
+
+         if (myid == 0) { std::cout << "remapping for H1" << std::endl; }
+         Vector vxyz = *pmesh_copy->GetNodes(); // from target mesh
+         const int point_ordering =
+            pmesh_copy->GetNodes()->FESpace()->GetOrdering();
+         FindPointsGSLIB finder(comm);
+         finder.Setup(*pmesh_old);
+         Vector interp_vals(v_gf.Size());
+         finder.Interpolate(vxyz, v_gf, interp_vals, point_ordering);
+         for (int i = 0; i < interp_vals.Size(); i++)
+         {
+            if (interp_vals[i] != 0.0) { v_gf[i] = interp_vals[i]; }
+         }
+         finder.Interpolate(vxyz, *u_gf, interp_vals, point_ordering);
+         for (int i = 0; i < interp_vals.Size(); i++)
+         {
+            if (interp_vals[i] != 0.0) { (*u_gf)[i] = interp_vals[i]; }
+         }
+      }
+      delete pmesh_old;
+      delete pmesh_copy;
+      delete pmesh_copy_old;
+
+      if (initial)
+      {
+         *x_ini_gf = *pmesh->GetNodes(); // copy optimized initial mesh
+      }
+
+      // The aspect ratios of the new mesh are the reference for the next
+      // remeshing.
+      UpdateMeshQuality(true);
+      if (min_vol < 0) { MFEM_ABORT("Negative Jacobian (volume) occurs!"); }
+   }
+
+   void Simulation::Reset()
+   {
+      *S = *S_init;
+      *p_gf = *p_init_gf;
+      *u_gf = 0.0;
+      x_gf.SyncAliasMemory(*S);
+      v_gf.SyncAliasMemory(*S);
+      e_gf.SyncAliasMemory(*S);
+      s_gf.SyncAliasMemory(*S);
+      geo->UpdateMesh(*S);
+      pmesh->DeleteGeometricFactors();
+
+      // A remeshing remapped the material fields.
+      SetMaterials();
+      if (param.control.selective_mscale) { geo->ComputeMassScaling(); }
+      geo->TMOPUpdate(*S, false);
+      geo->ResetQuadratureData();
+      StartTimeStepping();
+   }
+
+   void Simulation::Reset(const Param &p)
+   {
+      const Param np = ToSeconds(p);
+      MFEM_VERIFY(np.mesh.mesh_file == param.mesh.mesh_file &&
+                  np.sim.dim == param.sim.dim &&
+                  np.mesh.rs_levels == param.mesh.rs_levels &&
+                  np.mesh.rp_levels == param.mesh.rp_levels &&
+                  np.mesh.local_refinement == param.mesh.local_refinement &&
+                  np.mesh.partition_type == param.mesh.partition_type &&
+                  np.mesh.order_v == param.mesh.order_v &&
+                  np.mesh.order_e == param.mesh.order_e &&
+                  np.mesh.order_q == param.mesh.order_q &&
+                  np.solver.ode_solver_type == param.solver.ode_solver_type &&
+                  np.bc.bc_ids == param.bc.bc_ids,
+                  "Reset() keeps the mesh, the spaces and the boundary types; "
+                  "call Setup() for new ones");
+      const bool p_assembly = param.solver.p_assembly;
+      param = np;
+      param.solver.p_assembly = p_assembly;
+
+      // New values on the initial mesh.
+      *S = *S_init;
+      x_gf.SyncAliasMemory(*S);
+      geo->UpdateMesh(*S);
+      pmesh->DeleteGeometricFactors();
+
+      SetBoundaryConditions();
+      SetMaterials();
+      SetInitialFields();
+      SetSurfaces();
+      *S_init = *S;
+      *p_init_gf = *p_gf;
+
+      // The mass matrices and the reference quadrature data depend on the
+      // densities and the controls.
+      geo->SetControls(param.control.mscale, param.control.gravity,
+                       param.control.thickness, param.control.winkler_rho,
+                       param.control.dyn_factor, max_vbc_val);
+      geo->SetSelectiveMassScaling(param.control.selective_mscale,
+                                   param.control.smscale_h,
+                                   param.control.smscale_max_added);
+      geo->TMOPUpdate(*S, false);
+      geo->ResetQuadratureData();
+      StartTimeStepping();
+   }
+}
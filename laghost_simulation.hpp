@@ -0,0 +1,268 @@
+#ifndef MFEM_LAGHOST_SIMULATION
+#define MFEM_LAGHOST_SIMULATION
+
+#include "mfem.hpp"
+#include "parameters.hpp"
+#include "laghost_solver.hpp"
+#include "laghost_bc.hpp"
+#include "laghost_dt.hpp"
+#include "laghost_profile.hpp"
+#include "laghost_memory.hpp"
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace mfem
+{
+   // Setup steps shared by the laghost driver and Simulation.
+
+   // Values of a list option, "[a, b, c]" or "a,b,c".
+   template <typename T>
+   std::vector<T> ParseList(const std::string &list)
+   {
+      std::string s;
+      for (char c : list) { if (c != '[' && c != ']' && c != ' ') { s += c; } }
+      std::vector<T> vals;
+      std::stringstream ss(s);
+      std::string token;
+      while (std::getline(ss, token, ','))
+      {
+         std::istringstream ts(token);
+         T v;
+         ts >> v;
+         vals.push_back(v);
+      }
+      return vals;
+   }
+
+   // Per-material values, v(i) for the material with attribute i+1. A single
+   // value is used for all materials; false if vals has neither 1 nor nmat
+   // entries.
+   bool MaterialValues(const std::vector<double> &vals, const int nmat,
+                       Vector &v);
+
+   // Boundary velocity unit in m/s (or m/yr with sim.year) of bc.bc_unit.
+   double VelocityUnit(const Param &param);
+
+   // Serial mesh of mesh.mesh_file (or the builtin one), refined by
+   // mesh.rs_levels and, with mesh.local_refinement, locally by material.
+   Mesh *MakeSerialMesh(const Param &param);
+
+   // Partition of mesh for mesh.partition_type, refined by mesh.rp_levels.
+   // nullptr, with a message on rank 0, for an unknown partition type or a
+   // METIS partition without METIS.
+   ParMesh *MakeParMesh(MPI_Comm comm, Mesh &mesh, const Param &param);
+
+   // Explicit ODE solver of solver.ode_solver_type, nullptr if unknown.
+   ODESolver *MakeODESolver(const int type);
+
+   // Diffusion of a boundary elevation field, M du/dt = -K(u) u with
+   // K(u) = kappa + alpha u, for the surface processes.
+   class ConductionOperator : public TimeDependentOperator
+   {
+   protected:
+      ParFiniteElementSpace &fespace;
+      Array<int> ess_tdof_list; // this list remains empty for pure Neumann b.c.
+
+      ParBilinearForm *M;
+      ParBilinearForm *K;
+
+      HypreParMatrix Mmat;
+      HypreParMatrix Kmat;
+      HypreParMatrix *T; // T = M + dt K
+      double current_dt;
+
+      CGSolver M_solver;    // Krylov solver for inverting the mass matrix M
+      HypreSmoother M_prec; // Preconditioner for the mass matrix M
+
+      CGSolver T_solver;    // Implicit solver for T = M + dt K
+      HypreSmoother T_prec; // Preconditioner for the implicit solver
+
+      double alpha, kappa;
+
+      mutable Vector z; // auxiliary vector
+
+   public:
+      ConductionOperator(ParFiniteElementSpace &f, double alpha, double kappa,
+                         const Vector &u);
+
+      virtual void Mult(const Vector &u, Vector &du_dt) const;
+      /** Solve the Backward-Euler equation: k = f(u + dt*k, t), for the unknown k.
+          This is the only requirement for high-order SDIRK implicit integration.*/
+      virtual void ImplicitSolve(const double dt, const Vector &u, Vector &k);
+
+      /// Update the diffusion BilinearForm K using the given true-dof vector `u`.
+      void SetParameters(const Vector &u);
+
+      virtual ~ConductionOperator();
+   };
+
+   // The Lagrangian elasto-(visco)plastic model of laghost as a library.
+   //
+   // Setup() builds the mesh, the finite element spaces, the initial fields
+   // and the operators. Advance() takes time steps with the adaptive time
+   // step control, the pseudo-transient iterations, the surface processes,
+   // the plastic return mapping and the inverted element retries. Reset()
+   // goes back to the initial state, optionally with new material, boundary
+   // and control values, and keeps the mesh, the spaces and the operators,
+   // so repeated runs (parameter sweeps, inverse modelling) only pay for the
+   // setup once.
+   //
+   // The laghost driver is Setup() and Advance() with two hooks: the remesh
+   // hook decides when to call Remesh() and writes the output around it, the
+   // output hook writes the log and the output files after each step.
+   class Simulation
+   {
+   public:
+      // Called after the return mapping of the step with the given number,
+      // before the time step control. Returns true if the mesh was remeshed;
+      // the step is then kept without a time step check.
+      using RemeshHook = std::function<bool(int step)>;
+      // Called after each accepted step; last is true for the final one.
+      using OutputHook = std::function<void(int step, bool last)>;
+      // Called before the run aborts on a crashed time step.
+      using AbortHook = std::function<void(int step)>;
+
+   private:
+      MPI_Comm comm;
+      int myid;
+      Param param;
+      int dim;
+
+      ParMesh *pmesh;
+      std::unique_ptr<FiniteElementCollection> L2FEC, H1FEC, l2_fec, mat_fec;
+      std::unique_ptr<ParFiniteElementSpace> L2FESpace, H1FESpace,
+          L2FESpace_stress, L2FESpace_mat, l2_fes, mat_fes, xyz_fes,
+          L2FESpace_geometric;
+
+      Array<int> offset;
+      std::unique_ptr<BlockVector> S, S_old, S_init;
+      ParGridFunction x_gf, v_gf, e_gf, s_gf;
+      std::unique_ptr<ParGridFunction> rho0_gf, fictitious_rho0_gf,
+          lambda0_gf, mu0_gf, mat_gf, comp_gf, comp_ref_gf, s_old_gf, p_gf,
+          p_gf_old, p_init_gf, ini_p_gf, ini_p_old_gf, u_gf, x_ini_gf,
+          x_old_gf, quality, vol_ini_gf, skew_ini_gf;
+
+      // Top (attribute 4) and bottom (attribute 3) boundary submeshes with
+      // their node positions and elevations, for the surface processes and
+      // the flat boundaries of the remeshing. Not built in 1D.
+      std::unique_ptr<ParSubMesh> top_mesh, bottom_mesh;
+      std::unique_ptr<ParFiniteElementSpace> top_fes, top_elev_fes,
+          bottom_fes, bottom_elev_fes;
+      std::unique_ptr<ParGridFunction> x_top, topo, x_bottom, bottom;
+      std::unique_ptr<ConductionOperator> top_diff, bottom_diff;
+      std::unique_ptr<ODESolver> top_solver, bottom_solver;
+
+      // Bounding box of the initial mesh.
+      Vector bb_center, bb_length;
+
+      std::vector<int> bc_id;
+      std::unique_ptr<VelocityBC> vbc;
+      Array<int> ess_tdofs;
+      Vector bc_id_pa;
+      double max_vbc_val;
+
+      Vector z_rho, s_rho, lambda, mu, tension_cutoff, cohesion0, cohesion1,
+             friction_angle0, friction_angle1, dilation_angle0,
+             dilation_angle1, plastic_viscosity, pls0, pls1;
+
+      std::unique_ptr<geodynamics::LagrangianGeoOperator> geo;
+      std::unique_ptr<ODESolver> ode_solver;
+      std::unique_ptr<TimeStepController> dt_ctrl;
+
+      RemeshHook remesh_hook;
+      OutputHook output_hook;
+      AbortHook abort_hook;
+      RankProfile *profile;
+      MemoryLedger *mem_ledger;
+
+      double t, dt, dt_old, dt_est, h_min, max_skew, min_vol;
+      int steps, ode_steps;
+
+      void Clear();
+      void SetBoundaryConditions();
+      void SetMaterials();
+      void SetInitialFields();
+      void SetSurfaces();
+      void StartTimeStepping();
+      void DiffuseSurfaces();
+      void ReturnMapping();
+      // Geometric parameters of the elements; sets the minimum nodal volume
+      // and the largest aspect ratio change since the reference. With
+      // reference, the current aspect ratios become the reference.
+      void UpdateMeshQuality(const bool reference);
+      void Abort(const int step, const char *msg);
+
+   public:
+      Simulation(MPI_Comm comm = MPI_COMM_WORLD);
+      ~Simulation();
+
+      // Builds everything from param. Can be called again for a new mesh.
+      // The serial mesh, if given, is partitioned instead of the one of
+      // param; it is not owned.
+      void Setup(const Param &param, Mesh *serial_mesh = nullptr);
+
+      // Takes up to n_steps steps, fewer if the run is done. Returns the
+      // number of steps taken.
+      int Advance(const int n_steps);
+
+      // Optimizes the mesh with TMOP and remaps all fields to it. With
+      // initial, the optimized mesh also becomes the reference mesh.
+      void Remesh(const bool initial);
+
+      void SetRemeshHook(RemeshHook hook) { remesh_hook = hook; }
+      void SetOutputHook(OutputHook hook) { output_hook = hook; }
+      void SetAbortHook(AbortHook hook) { abort_hook = hook; }
+      // Optional instrumentation: the "rheology" phase and the plastic points
+      // of the profile, the "operator update" phase of the ledger.
+      void SetProfiling(RankProfile *p, MemoryLedger *m)
+      { profile = p; mem_ledger = m; }
+
+      // Back to t = 0 and the initial state. With a Param, the material,
+      // boundary velocity and control values are taken from it; the mesh and
+      // discretization options must be the ones given to Setup().
+      void Reset();
+      void Reset(const Param &param);
+
+      // sim.t_final is reached or, if set, sim.max_tsteps steps are taken.
+      bool Done() const
+      {
+         return t >= param.sim.t_final ||
+                (param.sim.max_tsteps > -1 && steps >= param.sim.max_tsteps);
+      }
+      double Time() const { return t; }
+      double TimeStep() const { return dt; }
+      int Steps() const { return steps; }
+      // ODE solver steps, including the repeated ones.
+      int OdeSteps() const { return ode_steps; }
+      double MinLength() const { return h_min; }
+      double MaxSkew() const { return max_skew; }
+      double MinVolume() const { return min_vol; }
+      // The param of Setup() with the times in seconds.
+      const Param &GetParam() const { return param; }
+
+      ParMesh &GetMesh() { return *pmesh; }
+      BlockVector &GetState() { return *S; }
+      ParGridFunction &Position() { return x_gf; }
+      ParGridFunction &Velocity() { return v_gf; }
+      ParGridFunction &Energy() { return e_gf; }
+      ParGridFunction &Stress() { return s_gf; }
+      ParGridFunction &PlasticStrain() { return *p_gf; }
+      ParGridFunction &InitialPlasticStrain() { return *ini_p_gf; }
+      ParGridFunction &Displacement() { return *u_gf; }
+      ParGridFunction &Density() { return *rho0_gf; }
+      ParGridFunction &Lambda() { return *lambda0_gf; }
+      ParGridFunction &Mu() { return *mu0_gf; }
+      ParGridFunction &Composition() { return *comp_gf; }
+      ParGridFunction &GeometricParameters() { return *quality; }
+      ParGridFunction &TopSurface() { return *x_top; }
+      ParGridFunction &BottomSurface() { return *x_bottom; }
+      geodynamics::LagrangianGeoOperator &GetOperator() { return *geo; }
+      const TimeStepController &GetTimeStepControl() const
+      { return *dt_ctrl; }
+   };
+}
+
+#endif // MFEM_LAGHOST_SIMULATION
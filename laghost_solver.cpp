@@ -16,6 +16,8 @@
 
 #include "general/forall.hpp"
 #include "laghost_solver.hpp"
+#include "laghost_bc.hpp"
+#include "laghost_profile.hpp"
 #include "linalg/kernels.hpp"
 #include <unordered_map>
 #include <cmath>
@@ -89,6 +91,16 @@ static void Rho0DetJ0Vol(const int dim, const int NE,
                          QuadratureData &qdata,
                          double &volume);
 
+static void EnergyMassInverse(const int NE, const IntegrationRule &ir,
+                              ParMesh *pmesh, ParFiniteElementSpace &L2,
+                              const ParGridFunction &rho0,
+                              DenseTensor &Me, DenseTensor &Me_inv);
+
+static void AddDamping(const Vector &vt, const int offset, const double f,
+                       Vector &B);
+
+static double MaxVelocityMagnitude(const Vector &v, const int dim);
+
 LagrangianGeoOperator::LagrangianGeoOperator(const int size,
                                                  ParFiniteElementSpace &h1,
                                                  ParFiniteElementSpace &l2,
@@ -109,7 +121,8 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
                                                  double ftz,
                                                  const int oq,
                                                  ParGridFunction &lambda_gf, ParGridFunction &mu_gf, double mscale, const double gravity, const double _thickness, 
-                                                 const bool winkler_foundation, const double _winkler_rho, const bool dyn_damping, const double _dyn_factor, Vector _bc_id_pa, const double _vbc_max_val) : // -0-
+                                                 const bool winkler_foundation, const double _winkler_rho, const bool dyn_damping, const double _dyn_factor, Vector _bc_id_pa, const double _vbc_max_val,
+                                                 const bool force_ea) : // -0-
    TimeDependentOperator(size),
    H1(h1), L2(l2), L2_stress(l2_stress), H1c(H1.GetParMesh(), H1.FEColl(), 1),
    pmesh(H1.GetParMesh()),
@@ -129,6 +142,7 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
    h1dofs_cnt(H1.GetFE(0)->GetDof()),
    source_type(source), cfl(cfl),
    mass_scale(mscale), grav_mag(gravity), thickness(_thickness), winkler_rho(_winkler_rho), dyn_factor(_dyn_factor), vbc_max_val(_vbc_max_val),
+   selective_mscale(false), smscale_h(0.0), smscale_max_added(0.0),
    use_viscosity(visc),
    use_vorticity(vort),
    p_assembly(p_assembly),
@@ -147,6 +161,7 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
    // dilation_angle(_dilation_angle.Size()),
    Mv(&H1), Mv_spmat_copy(),
    fic_Mv(&H1), fic_Mv_spmat_copy(),
+   Mv_A(), Mv_prec(), Mv_cg(H1.GetParMesh()->GetComm()),
    Me(l2dofs_cnt, l2dofs_cnt, NE),
    Me_inv(l2dofs_cnt, l2dofs_cnt, NE),
    rho0_coeff(&rho0_gf),
@@ -155,6 +170,8 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
                    (oq > 0) ? oq : 3 * H1.GetOrder(0) + L2.GetOrder(0) - 1)),
    Q1D(int(floor(0.7 + pow(ir.GetNPoints(), 1.0 / dim)))),
    qdata(dim, NE, ir.GetNPoints()),
+   ms_rho0_coeff(rho0_coeff, qdata.elem_mscale),
+   ms_scale_rho0_coeff(scale_rho0_coeff, qdata.elem_mscale),
    qdata_is_current(false),
    forcemat_is_assembled(false),
    gmat_is_assembled(false),
@@ -162,8 +179,10 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
    // Force(&L2, &H1),
    // Body_Force(nullptr),
    Body_Force(&H1),
-   ForcePA(nullptr), VMassPA(nullptr), EMassPA(nullptr), StressPA(nullptr),
-   VMassPA_Jprec(nullptr),
+   ForcePA(nullptr), ForceEA(nullptr),
+   VMassPA(nullptr), EMassPA(nullptr), StressPA(nullptr),
+   VMassPA_rho(nullptr), VMassPA_Jprec(nullptr),
+   pa_ne(-1), pa_sequence(-1),
    CG_VMass(H1.GetParMesh()->GetComm()),
    CG_EMass(L2.GetParMesh()->GetComm()),
    timer(p_assembly ? L2TVSize : 1),
@@ -209,67 +228,8 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
    
    if (p_assembly)
    {
-      qupdate = new QUpdate(dim, NE, Q1D, visc, vort, cfl, &timer, gamma_gf, lambda_gf, mu_gf, ir, H1, L2, L2_stress); // -1-
-      // qupdate = new QUpdate(dim, NE, Q1D, visc, vort, cfl,
-      //                       &timer, gamma_gf, ir, H1, L2);                            
-      ForcePA = new ForcePAOperator(qdata, H1, L2, ir);
-      StressPA = new StressPAOperator(qdata, H1, L2, ir); // stress rate operator, slee
-      VMassPA = new MassPAOperator(H1c, ir, rho0_coeff);
-      // VMassPA = new MassPAOperator(H1c, ir, scale_rho0_coeff);
-      EMassPA = new MassPAOperator(L2, ir, rho0_coeff);
-      // Inside the above constructors for mass, there is reordering of the mesh
-      // nodes which is performed on the host. Since the mesh nodes are a
-      // subvector, so we need to sync with the rest of the base vector (which
-      // is assumed to be in the memory space used by the mfem::Device).
-      H1.GetParMesh()->GetNodes()->ReadWrite();
-      // Attributes 1/2/3 correspond to fixed-x/y/z boundaries, i.e.,
-      // we must enforce v_x/y/z = 0 for the velocity components.
-      const int bdr_attr_max = H1.GetMesh()->bdr_attributes.Max();
-      Array<int> ess_bdr(bdr_attr_max);
-   
-      for (int c = 0; c < dim; c++)
-      {
-         ess_bdr = 0;
+      SetupPAOperators();
 
-         if(dim == 2)
-         {
-            if(c == 0)
-            {
-               for (int i = 0; i < bc_id_pa.Size(); ++i) {if(bc_id_pa[i]==1 || bc_id_pa[i]==3){ess_bdr[i] = 1;}}
-               H1c.GetEssentialTrueDofs(ess_bdr, c_tdofs[c]);
-               c_tdofs[c].Read();
-            }
-            else if(c == 1)
-            {
-               for (int i = 0; i < bc_id_pa.Size(); ++i) {if(bc_id_pa[i]==2 || bc_id_pa[i]==3){ess_bdr[i] = 1;}}
-               H1c.GetEssentialTrueDofs(ess_bdr, c_tdofs[c]);
-               c_tdofs[c].Read();
-            }
-         }
-         else
-         {
-            if(c == 0)
-            {
-               for (int i = 0; i < bc_id_pa.Size(); ++i) {if(bc_id_pa[i]==1 || bc_id_pa[i]==4 || bc_id_pa[i]==5 || bc_id_pa[i]==6){ess_bdr[i] = 1;}}
-               H1c.GetEssentialTrueDofs(ess_bdr, c_tdofs[c]);
-               c_tdofs[c].Read();
-            }
-            else if(c == 1)
-            {
-               for (int i = 0; i < bc_id_pa.Size(); ++i) {if(bc_id_pa[i]==2 || bc_id_pa[i]==4 || bc_id_pa[i]==5 || bc_id_pa[i]==7){ess_bdr[i] = 1;}}
-               H1c.GetEssentialTrueDofs(ess_bdr, c_tdofs[c]);
-               c_tdofs[c].Read();
-            }
-            else
-            {
-               for (int i = 0; i < bc_id_pa.Size(); ++i) {if(bc_id_pa[i]==3 || bc_id_pa[i]==4 || bc_id_pa[i]==6 || bc_id_pa[i]==7){ess_bdr[i] = 1;}}
-               H1c.GetEssentialTrueDofs(ess_bdr, c_tdofs[c]);
-               c_tdofs[c].Read();
-            }
-            
-         }
-      }
-      
       X.UseDevice(true);
       B.UseDevice(true);
       rhs.UseDevice(true);
@@ -279,16 +239,7 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
       // Standard local (full) assembly and inversion for energy mass matrices.
       // 'Me' is used in the computation of stress
       // std::cout << "Standard local assembly and inversion for energy mass matrices" << std::endl;
-      MassIntegrator mi(rho0_coeff, &ir);
-      for (int e = 0; e < NE; e++)
-      {
-         DenseMatrixInverse inv(&Me(e));
-         const FiniteElement &fe = *L2.GetFE(e);
-         ElementTransformation &Tr = *L2.GetElementTransformation(e);
-         mi.AssembleElementMatrix(fe, Tr, Me(e));
-         inv.Factor();
-         inv.GetInverseMatrix(Me_inv(e));
-      }
+      EnergyMassInverse(NE, ir, pmesh, L2, rho0_gf, Me, Me_inv);
 
    }
    else
@@ -296,16 +247,7 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
       // Standard local assembly and inversion for energy mass matrices.
       // 'Me' is used in the computation of the internal energy
       // which is used twice: once at the start and once at the end of the run.
-      MassIntegrator mi(rho0_coeff, &ir);
-      for (int e = 0; e < NE; e++)
-      {
-         DenseMatrixInverse inv(&Me(e));
-         const FiniteElement &fe = *L2.GetFE(e);
-         ElementTransformation &Tr = *L2.GetElementTransformation(e);
-         mi.AssembleElementMatrix(fe, Tr, Me(e));
-         inv.Factor();
-         inv.GetInverseMatrix(Me_inv(e));
-      }
+      EnergyMassInverse(NE, ir, pmesh, L2, rho0_gf, Me, Me_inv);
       
       // Standard assembly for the velocity mass matrix.
 
@@ -314,40 +256,25 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
       Mv.Assemble();
       Mv_spmat_copy = Mv.SpMat();
 
-      VectorMassIntegrator *vmi_scale = new VectorMassIntegrator(scale_rho0_coeff, &ir);
+      VectorMassIntegrator *vmi_scale = new VectorMassIntegrator(ms_scale_rho0_coeff, &ir);
       fic_Mv.AddDomainIntegrator(vmi_scale);
       fic_Mv.Assemble();
       fic_Mv_spmat_copy = Mv.SpMat();
+
+      Mv_prec.SetType(HypreSmoother::Chebyshev);
+      Mv_cg.SetPreconditioner(Mv_prec);
+      Mv_cg.SetRelTol(cg_rel_tol);
+      Mv_cg.SetAbsTol(0.0);
+      Mv_cg.SetMaxIter(cg_max_iter);
+      Mv_cg.SetPrintLevel(-1);
+      FormVelocitySystem();
    }
 
    // Values of rho0DetJ0 and Jac0inv at all quadrature points.
    // Initial local mesh size (assumes all mesh elements are the same).
    int Ne, ne = NE;
    double Volume, vol = 0.0;
-   if (dim > 1 && p_assembly)
-   {
-      Rho0DetJ0Vol(dim, NE, ir, pmesh, L2, rho0_gf, qdata, vol);
-   }
-   else
-   {
-      const int NQ = ir.GetNPoints();
-      Vector rho_vals(NQ);
-      for (int e = 0; e < NE; e++)
-      {
-         rho0_gf.GetValues(e, ir, rho_vals);
-         ElementTransformation &Tr = *H1.GetElementTransformation(e);
-         for (int q = 0; q < NQ; q++)
-         {
-            const IntegrationPoint &ip = ir.IntPoint(q);
-            Tr.SetIntPoint(&ip);
-            DenseMatrixInverse Jinv(Tr.Jacobian());
-            Jinv.GetInverseMatrix(qdata.Jac0inv(e*NQ + q));
-            const double rho0DetJ0 = Tr.Weight() * rho_vals(q);
-            qdata.rho0DetJ0w(e*NQ + q) = rho0DetJ0 * ir.IntPoint(q).weight;
-         }
-      }
-      for (int e = 0; e < NE; e++) { vol += pmesh->GetElementVolume(e); }
-   }
+   Rho0DetJ0Vol(dim, NE, ir, pmesh, L2, rho0_gf, qdata, vol);
    MPI_Allreduce(&vol, &Volume, 1, MPI_DOUBLE, MPI_SUM, pmesh->GetComm());
    MPI_Allreduce(&ne, &Ne, 1, MPI_INT, MPI_SUM, pmesh->GetComm());
    switch (pmesh->GetElementBaseGeometry(0))
@@ -363,19 +290,12 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
 
    if (p_assembly)
    {
-      // Setup the preconditioner of the velocity mass operator.
-      // BC are handled by the VMassPA, so ess_tdofs here can be empty.
-      Array<int> empty_tdofs;
-      VMassPA_Jprec = new OperatorJacobiSmoother(VMassPA->GetBF(), empty_tdofs);
-      CG_VMass.SetPreconditioner(*VMassPA_Jprec);
-
-      CG_VMass.SetOperator(*VMassPA);
+      // The operators and the preconditioner are set in SetupPAOperators().
       CG_VMass.SetRelTol(cg_rel_tol);
       CG_VMass.SetAbsTol(0.0);
       CG_VMass.SetMaxIter(cg_max_iter);
       CG_VMass.SetPrintLevel(-1);
 
-      CG_EMass.SetOperator(*EMassPA);
       CG_EMass.iterative_mode = false;
       CG_EMass.SetRelTol(cg_rel_tol);
       CG_EMass.SetAbsTol(0.0);
@@ -384,12 +304,19 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
    }
    else
    {
-      ForceIntegrator *fi = new ForceIntegrator(qdata);
-      fi->SetIntRule(&ir);
-      Force.AddDomainIntegrator(fi);
-      // Make a dummy assembly to figure out the sparsity.
-      Force.Assemble(0);
-      Force.Finalize(0);
+      if (force_ea)
+      {
+         ForceEA = new ForceEAOperator(qdata, H1, L2, ir);
+      }
+      else
+      {
+         ForceIntegrator *fi = new ForceIntegrator(qdata);
+         fi->SetIntRule(&ir);
+         Force.AddDomainIntegrator(fi);
+         // Make a dummy assembly to figure out the sparsity.
+         Force.Assemble(0);
+         Force.Finalize(0);
+      }
       // Standarad fully aseembly for body force integarator
       BodyForceIntegrator *bi = new BodyForceIntegrator(qdata);
       bi->SetIntRule(&ir);
@@ -401,10 +328,12 @@ LagrangianGeoOperator::LagrangianGeoOperator(const int size,
 LagrangianGeoOperator::~LagrangianGeoOperator()
 {
    delete qupdate;
+   delete ForceEA;
    if (p_assembly)
    {
       delete EMassPA;
       delete VMassPA;
+      delete VMassPA_rho;
       delete VMassPA_Jprec;
       delete ForcePA;
       delete StressPA;
@@ -412,6 +341,156 @@ LagrangianGeoOperator::~LagrangianGeoOperator()
    }
 }
 
+void LagrangianGeoOperator::SetupPAOperators()
+{
+   // Called again after remeshing: the PA data depends on the mesh geometry
+   // and the number of elements.
+   delete qupdate;
+   delete ForcePA;
+   delete StressPA;
+   delete VMassPA;
+   delete VMassPA_rho;
+   delete EMassPA;
+   delete VMassPA_Jprec;
+   qupdate = new QUpdate(dim, NE, Q1D, use_viscosity, use_vorticity, cfl, &timer, gamma_gf, lambda_gf, mu_gf, ir, H1, L2, L2_stress); // -1-
+   // qupdate = new QUpdate(dim, NE, Q1D, use_viscosity, use_vorticity, cfl,
+   //                       &timer, gamma_gf, ir, H1, L2);                            
+   ForcePA = new ForcePAOperator(qdata, H1, L2, ir);
+   StressPA = new StressPAOperator(qdata, H1, L2, ir); // stress rate operator, slee
+   VMassPA = new MassPAOperator(H1c, ir, ms_rho0_coeff);
+   VMassPA_rho = selective_mscale ? new MassPAOperator(H1c, ir, rho0_coeff)
+                                  : nullptr;
+   // VMassPA = new MassPAOperator(H1c, ir, scale_rho0_coeff);
+   EMassPA = new MassPAOperator(L2, ir, rho0_coeff);
+   // Inside the above constructors for mass, there is reordering of the mesh
+   // nodes which is performed on the host. Since the mesh nodes are a
+   // subvector, so we need to sync with the rest of the base vector (which
+   // is assumed to be in the memory space used by the mfem::Device).
+   H1.GetParMesh()->GetNodes()->ReadWrite();
+   // Per-component essential dofs; the bc_ids types select the constrained
+   // components (see VelocityBC).
+   const int bdr_attr_max = H1.GetMesh()->bdr_attributes.Max();
+   Array<int> ess_bdr(bdr_attr_max);
+
+   for (int c = 0; c < dim; c++)
+   {
+      ess_bdr = 0;
+      for (int i = 0; i < bc_id_pa.Size(); ++i)
+      {
+         if (VelocityBC::ComponentMask(dim, (int) bc_id_pa[i]) & (1 << c)) { ess_bdr[i] = 1; }
+      }
+      H1c.GetEssentialTrueDofs(ess_bdr, c_tdofs[c]);
+      c_tdofs[c].Read();
+   }
+
+   // Setup the preconditioner of the velocity mass operator.
+   // BC are handled by the VMassPA, so ess_tdofs here can be empty.
+   Array<int> empty_tdofs;
+   VMassPA_Jprec = new OperatorJacobiSmoother(VMassPA->GetBF(), empty_tdofs);
+   CG_VMass.SetPreconditioner(*VMassPA_Jprec);
+   CG_VMass.SetOperator(*VMassPA);
+   CG_EMass.SetOperator(*EMassPA);
+   pa_ne = NE;
+   pa_sequence = pmesh->GetSequence();
+}
+
+void LagrangianGeoOperator::UpdatePAOperators()
+{
+   // The force, stress and QUpdate operators only hold element restrictions
+   // and scratch sized by NE; the geometry enters through qdata. The mass
+   // data and the Jacobi diagonal are recomputed from the moved nodes.
+   VMassPA->Reassemble();
+   if (VMassPA_rho) { VMassPA_rho->Reassemble(); }
+   EMassPA->Reassemble();
+   H1.GetParMesh()->GetNodes()->ReadWrite();
+   Vector diag(H1c.GetTrueVSize());
+   VMassPA->GetBF().AssembleDiagonal(diag);
+   VMassPA_Jprec->Setup(diag);
+}
+
+void LagrangianGeoOperator::ComputeMassScaling()
+{
+   qdata.elem_mscale.SetSize(NE);
+   qdata.elem_mscale = 1.0;
+   if (!selective_mscale) { return; }
+   MFEM_VERIFY(smscale_h >= 0.0 && smscale_max_added >= 0.0,
+               "control.smscale_h and control.smscale_max_added must not be "
+               "negative.");
+   const MPI_Comm comm = pmesh->GetComm();
+
+   // Element size as in the time step estimate, and element mass.
+   const int NQ = ir.GetNPoints();
+   const double h1order = (double) H1.GetOrder(0);
+   Vector h(NE), m(NE), rho_vals(NQ);
+   double loc[3] = {0.0, 0.0, (double) NE}, glob[3];
+   double h_min = std::numeric_limits<double>::infinity(), glob_h_min;
+   for (int e = 0; e < NE; e++)
+   {
+      ElementTransformation &Tr = *H1.GetElementTransformation(e);
+      rho0_gf.GetValues(e, ir, rho_vals);
+      h(e) = std::numeric_limits<double>::infinity();
+      m(e) = 0.0;
+      for (int q = 0; q < NQ; q++)
+      {
+         const IntegrationPoint &ip = ir.IntPoint(q);
+         Tr.SetIntPoint(&ip);
+         h(e) = fmin(h(e), Tr.Jacobian().CalcSingularvalue(dim-1) / h1order);
+         m(e) += ip.weight * Tr.Weight() * rho_vals(q);
+      }
+      h_min = fmin(h_min, h(e));
+      loc[0] += h(e); loc[1] += m(e);
+   }
+   MPI_Allreduce(loc, glob, 3, MPI_DOUBLE, MPI_SUM, comm);
+   MPI_Allreduce(&h_min, &glob_h_min, 1, MPI_DOUBLE, MPI_MIN, comm);
+
+   // Added mass, as a fraction of the total, for the target size ht. Under a
+   // uniform velocity this is also the added kinetic energy.
+   auto added = [&](const double ht)
+   {
+      double a = 0.0, glob_a;
+      for (int e = 0; e < NE; e++)
+      {
+         if (h(e) < ht) { a += (ht * ht / (h(e) * h(e)) - 1.0) * m(e); }
+      }
+      MPI_Allreduce(&a, &glob_a, 1, MPI_DOUBLE, MPI_SUM, comm);
+      return glob_a / glob[1];
+   };
+   double ht = (smscale_h > 0.0) ? smscale_h : glob[0] / glob[2];
+   const double ht_req = ht;
+   if (added(ht) > smscale_max_added)
+   {
+      // The added mass grows with ht; bisection between the smallest
+      // element, which adds nothing, and the requested size.
+      double lo = glob_h_min, hi = ht;
+      for (int it = 0; it < 50; it++)
+      {
+         const double mid = 0.5 * (lo + hi);
+         if (added(mid) > smscale_max_added) { hi = mid; }
+         else { lo = mid; }
+      }
+      ht = lo;
+   }
+
+   int scaled = 0, glob_scaled;
+   for (int e = 0; e < NE; e++)
+   {
+      if (h(e) < ht)
+      {
+         qdata.elem_mscale(e) = ht * ht / (h(e) * h(e));
+         scaled++;
+      }
+   }
+   MPI_Reduce(&scaled, &glob_scaled, 1, MPI_INT, MPI_SUM, 0, comm);
+   const double frac = added(ht);
+   if (pmesh->GetMyRank() == 0)
+   {
+      std::cout << "Selective mass scaling: target size " << ht;
+      if (ht < ht_req) { std::cout << " (requested " << ht_req << ")"; }
+      std::cout << ", " << glob_scaled << " elements scaled, added mass "
+                << 100.0 * frac << "%" << std::endl;
+   }
+}
+
 void LagrangianGeoOperator::Mult(const Vector &S, Vector &dS_dt) const
 {
    // Make sure that the mesh positions correspond to the ones in S. This is
@@ -445,13 +524,6 @@ void LagrangianGeoOperator::SolveVelocity(const Vector &S, Vector &dS_dt) const
    Vector* sptr = const_cast<Vector*>(&S);
    ParGridFunction v;
    v.MakeRef(&H1, *sptr, H1.GetVSize());
-   
-   Vector vel_mag(H1.GetVSize()/dim);
-   for (int i = 0; i < H1.GetVSize()/dim; i++)
-   {
-      if(dim == 2){vel_mag[i] = sqrt(pow(v[i], 2) + pow(v[i+H1.GetVSize()/dim], 2));}
-      else{vel_mag[i] = sqrt(pow(v[i], 2) + pow(v[i+H1.GetVSize()/dim], 2) + pow(v[i+2*H1.GetVSize()/dim], 2));}
-   }
 
    double bulkm = lambda_gf.Max() + 2 * mu_gf.Max(); 
    double denm  = rho0_gf.Max();
@@ -474,7 +546,6 @@ void LagrangianGeoOperator::SolveVelocity(const Vector &S, Vector &dS_dt) const
    rhs.SetSize(H1.GetVSize());
    // Vector B, X; In AMR B and X should be redefined.
    one = 1.0; rhs = 0.0;
-   B.HostRead();
 
    // Body Force vector (F = 1 * g)
    ParGridFunction accel_src_gf;
@@ -494,6 +565,7 @@ void LagrangianGeoOperator::SolveVelocity(const Vector &S, Vector &dS_dt) const
       timer.sw_force.Start();
       ForcePA->Mult(one, rhs); // F*1
       timer.sw_force.Stop();
+      timer.Wait(timer.sw_wait_force);
       rhs.Neg(); // -F
 
       if(winkler_foundation)
@@ -534,6 +606,9 @@ void LagrangianGeoOperator::SolveVelocity(const Vector &S, Vector &dS_dt) const
       // Partial assembly solve for each velocity component
       const int size = H1c.GetVSize();
       const Operator *Pconf = H1c.GetProlongationMatrix();
+      // Velocity true dofs for the damping, shared by all components.
+      Vector vt;
+      if (dyn_damping) { GetVelocityTrueDofs(S, vt); }
       for (int c = 0; c < dim; c++)
       {
          dvc_gf.MakeRef(&H1c, dS_dt, H1Vsize + c*size);
@@ -549,7 +624,8 @@ void LagrangianGeoOperator::SolveVelocity(const Vector &S, Vector &dS_dt) const
             Vector AC;
             accel_comp.GetTrueDofs(AC);
             Vector BA(AC.Size());
-            VMassPA->MultFull(AC, BA);
+            // The gravity load uses the unscaled density.
+            (VMassPA_rho ? VMassPA_rho : VMassPA)->MultFull(AC, BA);
             B += BA; // -(F + rho*g)
          }
          
@@ -573,14 +649,7 @@ void LagrangianGeoOperator::SolveVelocity(const Vector &S, Vector &dS_dt) const
          // }
 
          // Applying damping for all forces such internal, external, and body
-         if(dyn_damping)
-         {
-            Vector damping(B.Size());
-            damping=0.0;
-            damping.Add(1.0, B);
-            Getdamping_comp(S, c, damping);
-            B.Add(dyn_factor, damping);
-         }
+         if(dyn_damping) { AddDamping(vt, c*B.Size(), dyn_factor, B); }
          
          H1c.GetRestrictionMatrix()->Mult(dvc_gf, X);
          VMassPA->SetEssentialTrueDofs(c_tdofs[c]);
@@ -589,6 +658,7 @@ void LagrangianGeoOperator::SolveVelocity(const Vector &S, Vector &dS_dt) const
          timer.sw_cgH1.Start();
          CG_VMass.Mult(B, X);
          timer.sw_cgH1.Stop();
+         timer.Wait(timer.sw_wait_cg);
          timer.H1iter += CG_VMass.GetNumIterations();
          X*=mfactor;
          if (Pconf) { Pconf->Mult(X, dvc_gf); }
@@ -602,8 +672,10 @@ void LagrangianGeoOperator::SolveVelocity(const Vector &S, Vector &dS_dt) const
    else // full assembly
    {
       timer.sw_force.Start();
-      Force.Mult(one, rhs);
+      if (ForceEA) { ForceEA->Mult(one, rhs); }
+      else { Force.Mult(one, rhs); }
       timer.sw_force.Stop();
+      timer.Wait(timer.sw_wait_force);
       rhs.Neg();
       // rhs += *v_source; 
 
@@ -641,41 +713,42 @@ void LagrangianGeoOperator::SolveVelocity(const Vector &S, Vector &dS_dt) const
          rhs.Add(winkler_rho*grav_mag,  winkler);
       }
 
-      HypreParMatrix A;
-      // Mv.FormLinearSystem(ess_tdofs, dv, rhs, A, X, B);
-      fic_Mv.FormLinearSystem(ess_tdofs, dv, rhs, A, X, B);
+      // Only the right-hand side changes between stages; Mv_A is formed in
+      // FormVelocitySystem(), this is the elimination of FormLinearSystem().
+      const Operator &P = *H1.GetProlongationMatrix();
+      B.SetSize(P.Width());
+      X.SetSize(P.Width());
+      P.MultTranspose(rhs, B);
+      H1.GetRestrictionMatrix()->Mult(dv, X);
+      fic_Mv.EliminateVDofsInRHS(ess_tdofs, X, B);
+      X.SetSubVectorComplement(ess_tdofs, 0.0);
 
       // Applying damping for all forces such internal, external, and body
       if(dyn_damping)
       {
-         Vector damping(B.Size());
-         damping=0.0;
-         damping.Add(1.0, B);
-         Getdamping(S, damping);
-         B.Add(dyn_factor, damping);
-         //
+         Vector vt;
+         GetVelocityTrueDofs(S, vt);
+         AddDamping(vt, 0, dyn_factor, B);
       }
 
-      CGSolver cg(H1.GetParMesh()->GetComm());
-      HypreSmoother prec;
-      // prec.SetType(HypreSmoother::Jacobi, 1); // l1-scaled Jacobi 
-      prec.SetType(HypreSmoother::Chebyshev);  // Chebyshev
-      cg.SetPreconditioner(prec);
-      cg.SetOperator(A);
-      cg.SetRelTol(cg_rel_tol);
-      cg.SetAbsTol(0.0);
-      cg.SetMaxIter(cg_max_iter);
-      cg.SetPrintLevel(-1);
       timer.sw_cgH1.Start();
-      cg.Mult(B, X);
+      Mv_cg.Mult(B, X);
       timer.sw_cgH1.Stop();
+      timer.Wait(timer.sw_wait_cg);
       // X*=mfactor;
-      timer.H1iter += cg.GetNumIterations();
+      timer.H1iter += Mv_cg.GetNumIterations();
       // Mv.RecoverFEMSolution(X, rhs, dv);
       fic_Mv.RecoverFEMSolution(X, rhs, dv);
    }
 }
 
+void LagrangianGeoOperator::FormVelocitySystem() const
+{
+   // The Chebyshev setup (eigenvalue estimate) runs in Mv_cg.SetOperator().
+   fic_Mv.FormSystemMatrix(ess_tdofs, Mv_A);
+   Mv_cg.SetOperator(Mv_A);
+}
+
 void LagrangianGeoOperator::SolveEnergy(const Vector &S, const Vector &v, Vector &dS_dt) const
 {
    // UpdateQuadratureData(S, dt);
@@ -729,10 +802,12 @@ void LagrangianGeoOperator::SolveEnergy(const Vector &S, const Vector &v, Vector
       timer.sw_force.Start();
       ForcePA->MultTranspose(v, e_rhs);
       timer.sw_force.Stop();
+      timer.Wait(timer.sw_wait_force);
       if (e_source) { e_rhs += *e_source; }
       timer.sw_cgL2.Start();
       CG_EMass.Mult(e_rhs, de);
       timer.sw_cgL2.Stop();
+      timer.Wait(timer.sw_wait_cg);
       const HYPRE_Int cg_num_iter = CG_EMass.GetNumIterations();
       timer.L2iter += (cg_num_iter==0) ? 1 : cg_num_iter;
       // Move the memory location of the subvector 'de' to the memory
@@ -742,8 +817,10 @@ void LagrangianGeoOperator::SolveEnergy(const Vector &S, const Vector &v, Vector
    else // not p_assembly
    {
       timer.sw_force.Start();
-      Force.MultTranspose(v, e_rhs);
+      if (ForceEA) { ForceEA->MultTranspose(v, e_rhs); }
+      else { Force.MultTranspose(v, e_rhs); }
       timer.sw_force.Stop();
+      timer.Wait(timer.sw_wait_force);
 
       if (e_source) { e_rhs += *e_source; }
       Vector loc_rhs(l2dofs_cnt), loc_de(l2dofs_cnt);
@@ -761,6 +838,53 @@ void LagrangianGeoOperator::SolveEnergy(const Vector &S, const Vector &v, Vector
    delete e_source;
 }
 
+// Full assembly stress rate of all elements and components at once: the
+// element right-hand sides from tauJinvT at the quadrature points, multiplied
+// by the inverse local mass matrices. dsig is ordered by component, then by
+// element (byNODES).
+static void StressRateFA(const int dim, const int NE, const int NQ,
+                         const int ND, const DofToQuad &maps,
+                         const DenseTensor &tauJinvT, const DenseTensor &Minv,
+                         Vector &dsig)
+{
+   constexpr int MAX_D = 64;
+   MFEM_VERIFY(ND <= MAX_D, "StressRateFA: too many stress dofs per element");
+   const int DIM = dim, NC = 3*(dim-1);
+   auto B = Reshape(maps.B.Read(), NQ, ND);
+   auto tau = Reshape(Read(tauJinvT.GetMemory(), NQ*NE*DIM*DIM),
+                      NQ*NE, DIM, DIM);
+   auto Mi = Reshape(Read(Minv.GetMemory(), ND*ND*NE), ND, ND, NE);
+   auto ds = Reshape(dsig.Write(), ND, NE, NC);
+   MFEM_FORALL(e, NE,
+   {
+      // (row, column) of tauJinvT for xx, yy, [zz,] xy, [xz, yz].
+      const int r2[3] = {0, 1, 0}, c2[3] = {0, 1, 1};
+      const int r3[6] = {0, 1, 2, 0, 0, 1}, c3[6] = {0, 1, 2, 1, 2, 2};
+      const int *rc = (DIM == 2) ? r2 : r3;
+      const int *cc = (DIM == 2) ? c2 : c3;
+      double rhs[6*MAX_D];
+      for (int i = 0; i < NC*ND; i++) { rhs[i] = 0.0; }
+      for (int q = 0; q < NQ; q++)
+      {
+         const int eq = e*NQ + q;
+         for (int c = 0; c < NC; c++)
+         {
+            const double t = tau(eq, cc[c], rc[c]);
+            for (int i = 0; i < ND; i++) { rhs[c*ND + i] += B(q, i) * t; }
+         }
+      }
+      for (int c = 0; c < NC; c++)
+      {
+         for (int i = 0; i < ND; i++)
+         {
+            double s = 0.0;
+            for (int j = 0; j < ND; j++) { s += Mi(i, j, e) * rhs[c*ND + j]; }
+            ds(i, e, c) = s;
+         }
+      }
+   });
+}
+
 void LagrangianGeoOperator::SolveStress(const Vector &S, Vector &dS_dt) const
 {
    UpdateQuadratureData(S);
@@ -777,6 +901,7 @@ void LagrangianGeoOperator::SolveStress(const Vector &S, Vector &dS_dt) const
          const int comp = i;
          StressPA->MultTranspose(v, s_rhs, comp);
          timer.sw_force.Stop();
+         timer.Wait(timer.sw_wait_force);
          
          ParGridFunction ds;
          ds.MakeRef(&L2, dS_dt, H1Vsize*2 + L2Vsize + L2Vsize*i);
@@ -784,6 +909,7 @@ void LagrangianGeoOperator::SolveStress(const Vector &S, Vector &dS_dt) const
          timer.sw_cgL2.Start();
          CG_EMass.Mult(s_rhs, ds);
          timer.sw_cgL2.Stop();
+         timer.Wait(timer.sw_wait_cg);
          const HYPRE_Int cg_num_iter = CG_EMass.GetNumIterations();
          timer.L2iter += (cg_num_iter==0) ? 1 : cg_num_iter;
          // Move the memory location of the subvector 'ds' to the memory
@@ -795,136 +921,11 @@ void LagrangianGeoOperator::SolveStress(const Vector &S, Vector &dS_dt) const
    {
       ParGridFunction dsig;
       dsig.MakeRef(&L2_stress, dS_dt, H1.GetVSize()*2 + L2.GetVSize());
-      int NED = NE*l2_stress_dofs_cnt;
-      int dim2 = dim*dim;
-      if(dim == 2)
-      {
-         Vector sub_rhs1(l2_stress_dofs_cnt), sub_rhs2(l2_stress_dofs_cnt), sub_rhs3(l2_stress_dofs_cnt);
-         Vector loc_dsig1(l2_stress_dofs_cnt), loc_dsig2(l2_stress_dofs_cnt), loc_dsig3(l2_stress_dofs_cnt);
-         loc_dsig1=0.0; loc_dsig2=0.0; loc_dsig3=0.0;
-         Array<int> offset(4); 
-         offset[0] = 0;
-         offset[1] = offset[0] + l2_stress_dofs_cnt;
-         offset[2] = offset[1] + l2_stress_dofs_cnt;
-         offset[3] = offset[2] + l2_stress_dofs_cnt;
-
-         BlockVector loc_rhs(offset, Device::GetMemoryType());
-
-         sub_rhs1.MakeRef(loc_rhs, 0*l2_stress_dofs_cnt);
-         sub_rhs2.MakeRef(loc_rhs, 1*l2_stress_dofs_cnt);
-         sub_rhs3.MakeRef(loc_rhs, 2*l2_stress_dofs_cnt);
-         loc_rhs = 0.0;
-   
-         SigmaIntegrator gi(qdata);
-         gi.SetIntRule(&ir);
-         Array<int> dof_loc1(l2_stress_dofs_cnt);
-         Array<int> dof_loc2(l2_stress_dofs_cnt);
-         Array<int> dof_loc3(l2_stress_dofs_cnt);
-      
-         for (int e = 0; e < NE; e++)
-         {
-
-            L2_stress.GetElementDofs(e, dof_loc1);
-            L2_stress.GetElementDofs(e, dof_loc2);
-            L2_stress.GetElementDofs(e, dof_loc3);
-         
-            const FiniteElement &fe = *L2_stress.GetFE(e);
-            ElementTransformation &eltr = *L2_stress.GetElementTransformation(e);
-            gi.AssembleRHSElementVect(fe, eltr, loc_rhs);
-
-            Me_inv(e).Mult(sub_rhs1, loc_dsig1);
-            Me_inv(e).Mult(sub_rhs2, loc_dsig2);
-            Me_inv(e).Mult(sub_rhs3, loc_dsig3);
-   
-            for (int i = 0; i < dof_loc1.Size(); i++)
-            {
-               dof_loc1[i] = i + (e+0*NE)*dof_loc1.Size(); 
-               dof_loc2[i] = i + (e+1*NE)*dof_loc1.Size();
-               dof_loc3[i] = i + (e+2*NE)*dof_loc1.Size(); 
-            }
-
-            dsig.SetSubVector(dof_loc1, loc_dsig1);
-            dsig.SetSubVector(dof_loc2, loc_dsig2);
-            dsig.SetSubVector(dof_loc3, loc_dsig3);
-         }
-      }
-      else if(dim == 3)
-      {
-         Vector sub_rhs1(l2_stress_dofs_cnt), sub_rhs2(l2_stress_dofs_cnt), sub_rhs3(l2_stress_dofs_cnt);
-         Vector sub_rhs4(l2_stress_dofs_cnt), sub_rhs5(l2_stress_dofs_cnt), sub_rhs6(l2_stress_dofs_cnt);
-
-         Vector loc_dsig1(l2_stress_dofs_cnt), loc_dsig2(l2_stress_dofs_cnt), loc_dsig3(l2_stress_dofs_cnt);
-         Vector loc_dsig4(l2_stress_dofs_cnt), loc_dsig5(l2_stress_dofs_cnt), loc_dsig6(l2_stress_dofs_cnt);
-
-         loc_dsig1=0.0; loc_dsig2=0.0; loc_dsig3=0.0; loc_dsig4=0.0; loc_dsig5=0.0; loc_dsig6=0.0;
-         Array<int> offset(7); 
-         offset[0] = 0;
-         offset[1] = offset[0] + l2_stress_dofs_cnt;
-         offset[2] = offset[1] + l2_stress_dofs_cnt;
-         offset[3] = offset[2] + l2_stress_dofs_cnt;
-         offset[4] = offset[3] + l2_stress_dofs_cnt;
-         offset[5] = offset[4] + l2_stress_dofs_cnt;
-         offset[6] = offset[5] + l2_stress_dofs_cnt;
-         
-         BlockVector loc_rhs(offset, Device::GetMemoryType());
-
-         sub_rhs1.MakeRef(loc_rhs, 0*l2_stress_dofs_cnt);
-         sub_rhs2.MakeRef(loc_rhs, 1*l2_stress_dofs_cnt);
-         sub_rhs3.MakeRef(loc_rhs, 2*l2_stress_dofs_cnt);
-         sub_rhs4.MakeRef(loc_rhs, 3*l2_stress_dofs_cnt);
-         sub_rhs5.MakeRef(loc_rhs, 4*l2_stress_dofs_cnt);
-         sub_rhs6.MakeRef(loc_rhs, 5*l2_stress_dofs_cnt);
-         
-         loc_rhs = 0.0;
-   
-         SigmaIntegrator gi(qdata);
-         gi.SetIntRule(&ir);
-         Array<int> dof_loc1(l2_stress_dofs_cnt);
-         Array<int> dof_loc2(l2_stress_dofs_cnt);
-         Array<int> dof_loc3(l2_stress_dofs_cnt);
-         Array<int> dof_loc4(l2_stress_dofs_cnt);
-         Array<int> dof_loc5(l2_stress_dofs_cnt);
-         Array<int> dof_loc6(l2_stress_dofs_cnt);
-         
-         for (int e = 0; e < NE; e++)
-         {
-
-            L2_stress.GetElementDofs(e, dof_loc1);
-            L2_stress.GetElementDofs(e, dof_loc2);
-            L2_stress.GetElementDofs(e, dof_loc3);
-            L2_stress.GetElementDofs(e, dof_loc4);
-            L2_stress.GetElementDofs(e, dof_loc5);
-            L2_stress.GetElementDofs(e, dof_loc6);
-            
-            const FiniteElement &fe = *L2_stress.GetFE(e);
-            ElementTransformation &eltr = *L2_stress.GetElementTransformation(e);
-            gi.AssembleRHSElementVect(fe, eltr, loc_rhs);
-
-            Me_inv(e).Mult(sub_rhs1, loc_dsig1);
-            Me_inv(e).Mult(sub_rhs2, loc_dsig2);
-            Me_inv(e).Mult(sub_rhs3, loc_dsig3);
-            Me_inv(e).Mult(sub_rhs4, loc_dsig4);
-            Me_inv(e).Mult(sub_rhs5, loc_dsig5);
-            Me_inv(e).Mult(sub_rhs6, loc_dsig6);
-
-            for (int i = 0; i < dof_loc1.Size(); i++)
-            {
-               dof_loc1[i] = i + (e+0*NE)*dof_loc1.Size(); 
-               dof_loc2[i] = i + (e+1*NE)*dof_loc1.Size();
-               dof_loc3[i] = i + (e+2*NE)*dof_loc1.Size(); 
-               dof_loc4[i] = i + (e+3*NE)*dof_loc1.Size(); 
-               dof_loc5[i] = i + (e+4*NE)*dof_loc1.Size(); 
-               dof_loc6[i] = i + (e+5*NE)*dof_loc1.Size(); 
-            }
-
-            dsig.SetSubVector(dof_loc1, loc_dsig1);
-            dsig.SetSubVector(dof_loc2, loc_dsig2);
-            dsig.SetSubVector(dof_loc3, loc_dsig3);
-            dsig.SetSubVector(dof_loc4, loc_dsig4);
-            dsig.SetSubVector(dof_loc5, loc_dsig5);
-            dsig.SetSubVector(dof_loc6, loc_dsig6);
-         }
-      }
+      const DofToQuad &maps =
+         L2_stress.GetFE(0)->GetDofToQuad(ir, DofToQuad::FULL);
+      StressRateFA(dim, NE, ir.GetNPoints(), l2_stress_dofs_cnt, maps,
+                   qdata.tauJinvT, Me_inv, dsig);
+      dsig.GetMemory().SyncAlias(dS_dt.GetMemory(), dsig.Size());
    }
 }
 
@@ -935,34 +936,47 @@ void LagrangianGeoOperator::UpdateMesh(const Vector &S) const
    H1.GetParMesh()->NewNodes(x_gf, false);
 }
 
-void LagrangianGeoOperator::Getdamping(const Vector &S, Vector &_v_damping) const
+void LagrangianGeoOperator::GetVelocityTrueDofs(const Vector &S, Vector &vt) const
 {
    Vector* sptr = const_cast<Vector*>(&S);
    ParGridFunction v;
    v.MakeRef(&H1, *sptr, H1.GetVSize());
-   v.SetTrueVector();
-   Vector vt = v.GetTrueVector();
-
-   for( int i = 0; i < _v_damping.Size(); i++ )
-   {  
-      _v_damping[i]=-1*copysignl(1.0, vt[i])*fabs(_v_damping[i]); //
-   }
+   vt.SetSize(H1.GetTrueVSize());
+   vt.UseDevice(true);
+   v.GetTrueDofs(vt);
 }
 
-void LagrangianGeoOperator::Getdamping_comp(const Vector &S, const int &comp, Vector &_v_damping) const
+// Largest nodal |v| of a byNODES H1 vector field. Vector::Max() reduces on
+// the host, Vector::Min() on the device, so the minimum of -|v| is taken.
+static double MaxVelocityMagnitude(const Vector &v, const int dim)
 {
-   // damping by each component in p_assembly
-   Vector* sptr = const_cast<Vector*>(&S);
-   ParGridFunction v;
-   v.MakeRef(&H1, *sptr, H1.GetVSize());
-   v.SetTrueVector();
-   Vector vt = v.GetTrueVector();
-   for( int i = 0; i < _v_damping.Size(); i++ )
+   const int N = v.Size()/dim;
+   Vector neg_vel_mag(N);
+   neg_vel_mag.UseDevice(true);
+   const double *d_v = v.Read();
+   double *m = neg_vel_mag.Write();
+   MFEM_FORALL(i, N,
    {
-      _v_damping[i]=-1*copysignl(1.0, vt[i+_v_damping.Size()*comp])*fabs(_v_damping[i]); //
-   }
+      double s = 0.0;
+      for (int c = 0; c < dim; c++) { s += d_v[i + c*N] * d_v[i + c*N]; }
+      m[i] = -sqrt(s);
+   });
+   return -neg_vel_mag.Min();
 }
 
+// Dynamic relaxation damping, B_i += f * (-sign(v_i) * |B_i|), with v read
+// from vt starting at offset.
+static void AddDamping(const Vector &vt, const int offset, const double f,
+                       Vector &B)
+{
+   MFEM_ASSERT(offset + B.Size() <= vt.Size(), "invalid damping offset");
+   const double *v = vt.Read() + offset;
+   double *b = B.ReadWrite();
+   MFEM_FORALL(i, B.Size(),
+   {
+      b[i] -= f * copysign(fabs(b[i]), v[i]);
+   });
+}
 
 void LagrangianGeoOperator::Winkler(const Vector &S, Vector &_winkler, double &_thickness) const
 {
@@ -1004,6 +1018,18 @@ double LagrangianGeoOperator::GetLengthEstimate(const Vector &S) const
    return glob_h_est;
 }
 
+void LagrangianGeoOperator::GetStepEstimates(const Vector &S, double &dt_est,
+                                             double &h_est) const
+{
+   UpdateMesh(S);
+   UpdateQuadratureData(S);
+   double loc[2] = { qdata.dt_est, qdata.h_est }, glob[2];
+   const MPI_Comm comm = H1.GetParMesh()->GetComm();
+   MPI_Allreduce(loc, glob, 2, MPI_DOUBLE, MPI_MIN, comm);
+   dt_est = glob[0];
+   h_est = glob[1];
+}
+
 void LagrangianGeoOperator::ResetTimeStepEstimate() const
 {
    qdata.dt_est = std::numeric_limits<double>::infinity();
@@ -1167,6 +1193,40 @@ double LagrangianGeoOperator::KineticEnergy(const ParGridFunction &v) const
    return 0.5*glob_ke;
 }
 
+static long SparseMatrixBytes(const SparseMatrix &A)
+{
+   return (long) A.NumNonZeroElems() * (sizeof(double) + sizeof(int)) +
+          (long) (A.Height() + 1) * sizeof(int);
+}
+
+void LagrangianGeoOperator::GetMemoryUsage(long &qdata_bytes,
+                                           long &matrix_bytes) const
+{
+   qdata_bytes = sizeof(double) * ((long) qdata.Jac0inv.TotalSize() +
+                                   qdata.stressJinvT.TotalSize() +
+                                   qdata.tauJinvT.TotalSize() +
+                                   qdata.buoyJinvT.TotalSize() +
+                                   qdata.rho0DetJ0w.Size());
+
+   matrix_bytes = sizeof(double) * ((long) Me.TotalSize() + Me_inv.TotalSize());
+   if (!p_assembly)
+   {
+      // The velocity mass matrices and their sparse matrix copies.
+      matrix_bytes += SparseMatrixBytes(Mv.SpMat());
+      matrix_bytes += SparseMatrixBytes(Mv_spmat_copy);
+      matrix_bytes += SparseMatrixBytes(fic_Mv.SpMat());
+      matrix_bytes += SparseMatrixBytes(fic_Mv_spmat_copy);
+      if (ForceEA)
+      {
+         matrix_bytes += ForceEA->MemoryBytes();
+      }
+      else if (forcemat_is_assembled)
+      {
+         matrix_bytes += SparseMatrixBytes(Force.SpMat());
+      }
+   }
+}
+
 void LagrangianGeoOperator::PrintTimingData(bool IamRoot, int steps,
                                               const bool fom) const
 {
@@ -1179,11 +1239,12 @@ void LagrangianGeoOperator::PrintTimingData(bool IamRoot, int steps,
    my_rt[4] = my_rt[0] + my_rt[2] + my_rt[3];
    MPI_Reduce(my_rt, T, 5, MPI_DOUBLE, MPI_MAX, 0, com);
 
-   HYPRE_Int mydata[3], alldata[3];
+   HYPRE_Int mydata[4], alldata[4];
    mydata[0] = timer.L2dof * timer.L2iter;
    mydata[1] = timer.quad_tstep;
    mydata[2] = NE;
-   MPI_Reduce(mydata, alldata, 3, HYPRE_MPI_INT, MPI_SUM, 0, com);
+   mydata[3] = timer.L2iter;
+   MPI_Reduce(mydata, alldata, 4, HYPRE_MPI_INT, MPI_SUM, 0, com);
 
    if (IamRoot)
    {
@@ -1199,10 +1260,12 @@ void LagrangianGeoOperator::PrintTimingData(bool IamRoot, int steps,
       cout << "CG (H1) total time: " << T[0] << endl;
       cout << "CG (H1) rate (megadofs x cg_iterations / second): "
            << FOM1 << endl;
+      cout << "CG (H1) iterations: " << H1iter << endl;
       cout << endl;
       cout << "CG (L2) total time: " << T[1] << endl;
       cout << "CG (L2) rate (megadofs x cg_iterations / second): "
            << 1e-6 * alldata[0] / T[1] << endl;
+      cout << "CG (L2) iterations: " << alldata[3] << endl;
       cout << endl;
       cout << "Forces total time: " << T[2] << endl;
       cout << "Forces rate (megadofs x timesteps / second): "
@@ -1300,19 +1363,12 @@ void LagrangianGeoOperator::UpdateQuadratureData(const Vector &S) const
    mscale = qdata.mscale;
    grav   = -1.0*qdata.gravity;
    
-   Vector vel_mag(H1.GetVSize()/dim);
-   for (int i = 0; i < H1.GetVSize()/dim; i++)
-   {
-      if(dim == 2){vel_mag[i] = sqrt(pow(v[i], 2) + pow(v[i+H1.GetVSize()/dim], 2));}
-      else{vel_mag[i] = sqrt(pow(v[i], 2) + pow(v[i+H1.GetVSize()/dim], 2) + pow(v[i+2*H1.GetVSize()/dim], 2));}
-   }
-
    double cut_off_vel   = 1.0/86400.0/365.25/1000.0/100.0; // 0.01 mm/yr
-   double local_max_vel = std::max(cut_off_vel, vel_mag.Max());
+   double local_max_vel = std::max(cut_off_vel, MaxVelocityMagnitude(v, dim));
    double global_max_vel;
-   MPI_Reduce(&local_max_vel, &global_max_vel, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+   MPI_Reduce(&local_max_vel, &global_max_vel, 1, MPI_DOUBLE, MPI_MAX, 0, H1.GetComm());
    // Broadcast the global_max from process 0 to all other processes
-   MPI_Bcast(&global_max_vel, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+   MPI_Bcast(&global_max_vel, 1, MPI_DOUBLE, 0, H1.GetComm());
 
 
    // Batched computations are needed, because geodynamic codes usually
@@ -1517,7 +1573,9 @@ void LagrangianGeoOperator::UpdateQuadratureData(const Vector &S) const
 
 
             const double vel_max = fmax(qdata.vbc_max_val, global_max_vel);
-            const double inv_dt  = (vel_max * qdata.mscale) / h_min;
+            // Selective mass scaling slows the waves in the element down.
+            const double inv_dt  = (vel_max * qdata.mscale) / h_min /
+                                   sqrt(qdata.elem_mscale(z_id));
             
             if (min_detJ < 0.0)
             {
@@ -1564,6 +1622,7 @@ void LagrangianGeoOperator::UpdateQuadratureData(const Vector &S) const
    delete [] mu_b;
    delete [] pmod_b;
    timer.sw_qdata.Stop();
+   timer.Wait(timer.sw_wait_qdata);
    timer.quad_tstep += NE;
 }
 
@@ -1662,6 +1721,7 @@ void QUpdateBody(const int NE, const int e,
                  const double* __restrict__ d_sig_quads,
                  const double* __restrict__ d_grad_v_ext,
                  const double* __restrict__ d_Jac0inv,
+                 const double* __restrict__ d_elem_mscale,
                  double *d_dt_est,
                  double *d_h_est,
                  double *d_stressJinvT,
@@ -1819,7 +1879,8 @@ void QUpdateBody(const int NE, const int e,
    const double irho_ih_min_sq = ih_min * ih_min / R ;
    // const double idt = S * ih_min + 2.5 * visc_coeff / R / h_min / h_min;
    // const double idt = S * ih_min + 1.0 * visc_coeff * irho_ih_min_sq;
-   const double idt = (max_vel_q * mscale_q) / h_min;
+   // Selective mass scaling slows the waves in the element down.
+   const double idt = (max_vel_q * mscale_q) / h_min / sqrt(d_elem_mscale[e]);
    if (min_detJ < 0.0)
    {
       // This will force repetition of the step with smaller dt.
@@ -1862,6 +1923,11 @@ static void Rho0DetJ0Vol(const int dim, const int NE,
 {
    const int NQ = ir.GetNPoints();
    const int Q1D = IntRules.Get(Geometry::SEGMENT,ir.GetOrder()).GetNPoints();
+   // Simplices loop over all points of the element in x.
+   const bool use_tensors = TensorMesh(*pmesh);
+   const int QX = use_tensors ? Q1D : NQ,
+             QY = use_tensors ? Q1D :  1,
+             QZ = use_tensors ? Q1D :  1;
    const int flags = GeometricFactors::JACOBIANS|GeometricFactors::DETERMINANTS;
    const GeometricFactors *geom = pmesh->GetGeometricFactors(ir, flags);
    Vector rho0Q(NQ*NE);
@@ -1881,16 +1947,30 @@ static void Rho0DetJ0Vol(const int dim, const int NE,
    Vector vol(NE*NQ), one(NE*NQ);
    auto A = Reshape(vol.Write(), NQ, NE);
    auto O = Reshape(one.Write(), NQ, NE);
-   MFEM_ASSERT(dim==2 || dim==3, "");
-   if (dim==2)
+   MFEM_ASSERT(dim>=1 && dim<=3, "");
+   if (dim==1)
+   {
+      MFEM_FORALL(e, NE,
+      {
+         for (int q = 0; q < NQ; q++)
+         {
+            const double det = detJ(q,e);
+            V(q,e) = W[q] * R(q,e) * det;
+            invJ(0,0,q,e) = 1.0 / J(q,0,0,e);
+            A(q,e) = W[q] * det;
+            O(q,e) = 1.0;
+         }
+      });
+   }
+   else if (dim==2)
    {
-      MFEM_FORALL_2D(e, NE, Q1D, Q1D, 1,
+      MFEM_FORALL_2D(e, NE, QX, QY, 1,
       {
-         MFEM_FOREACH_THREAD(qy,y,Q1D)
+         MFEM_FOREACH_THREAD(qy,y,QY)
          {
-            MFEM_FOREACH_THREAD(qx,x,Q1D)
+            MFEM_FOREACH_THREAD(qx,x,QX)
             {
-               const int q = qx + qy * Q1D;
+               const int q = qx + qy * QX;
                const double J11 = J(q,0,0,e);
                const double J12 = J(q,1,0,e);
                const double J21 = J(q,0,1,e);
@@ -1910,18 +1990,20 @@ static void Rho0DetJ0Vol(const int dim, const int NE,
    }
    else
    {
-      MFEM_FORALL_3D(e, NE, Q1D, Q1D, Q1D,
+      MFEM_FORALL_3D(e, NE, QX, QY, QZ,
       {
-         MFEM_FOREACH_THREAD(qz,z,Q1D)
+         MFEM_FOREACH_THREAD(qz,z,QZ)
          {
-            MFEM_FOREACH_THREAD(qy,y,Q1D)
+            MFEM_FOREACH_THREAD(qy,y,QY)
             {
-               MFEM_FOREACH_THREAD(qx,x,Q1D)
+               MFEM_FOREACH_THREAD(qx,x,QX)
                {
-                  const int q = qx + (qy + qz * Q1D) * Q1D;
-                  const double J11 = J(q,0,0,e), J12 = J(q,0,1,e), J13 = J(q,0,2,e);
-                  const double J21 = J(q,1,0,e), J22 = J(q,1,1,e), J23 = J(q,1,2,e);
-                  const double J31 = J(q,2,0,e), J32 = J(q,2,1,e), J33 = J(q,2,2,e);
+                  const int q = qx + (qy + qz * QY) * QX;
+                  // Named as in 2D, Jij = J(q,j-1,i-1,e), so that invJ
+                  // below is the inverse itself and not its transpose.
+                  const double J11 = J(q,0,0,e), J12 = J(q,1,0,e), J13 = J(q,2,0,e);
+                  const double J21 = J(q,0,1,e), J22 = J(q,1,1,e), J23 = J(q,2,1,e);
+                  const double J31 = J(q,0,2,e), J32 = J(q,1,2,e), J33 = J(q,2,2,e);
                   const double det = detJ(q,e);
                   V(q,e) = W[q] * R(q,e) * det;
                   const double r_idetJ = 1.0 / det;
@@ -1941,11 +2023,103 @@ static void Rho0DetJ0Vol(const int dim, const int NE,
          }
       });
    }
-   qdata.rho0DetJ0w.HostRead();
+   HostSync::Read("qdata rho0DetJ0w", qdata.rho0DetJ0w);
    volume = vol * one;
 }
 
+// Assembles the energy mass matrices Me(e) = (rho0 phi_i, phi_j)_e and their
+// inverses for all elements in one pass: the shape functions are tabulated
+// once, and every element matrix is factored in place with Cholesky, then
+// inverted as (L^{-1})^T L^{-1}.
+static void EnergyMassInverse(const int NE, const IntegrationRule &ir,
+                              ParMesh *pmesh, ParFiniteElementSpace &L2,
+                              const ParGridFunction &rho0,
+                              DenseTensor &Me, DenseTensor &Me_inv)
+{
+   if (NE == 0) { return; }
+   const FiniteElement &fe = *L2.GetFE(0);
+   MFEM_VERIFY(fe.GetMapType() == FiniteElement::VALUE,
+               "EnergyMassInverse: unsupported L2 map type");
+   const int NQ = ir.GetNPoints();
+   const int ND = fe.GetDof();
+   const DofToQuad &maps = fe.GetDofToQuad(ir, DofToQuad::FULL);
+   const GeometricFactors *geom =
+      pmesh->GetGeometricFactors(ir, GeometricFactors::DETERMINANTS);
+   Vector rho0Q(NQ*NE);
+   rho0Q.UseDevice(true);
+   Vector j, detj;
+   const QuadratureInterpolator *qi = L2.GetQuadratureInterpolator(ir);
+   qi->Mult(rho0, QuadratureInterpolator::VALUES, rho0Q, j, detj);
+
+   const auto W = ir.GetWeights().Read();
+   const auto B = Reshape(maps.B.Read(), NQ, ND);
+   const auto R = Reshape(rho0Q.Read(), NQ, NE);
+   const auto detJ = Reshape(geom->detJ.Read(), NQ, NE);
+   auto M = Reshape(Write(Me.GetMemory(), ND*ND*NE), ND, ND, NE);
+   auto A = Reshape(Write(Me_inv.GetMemory(), ND*ND*NE), ND, ND, NE);
+   MFEM_FORALL(e, NE,
+   {
+      for (int i = 0; i < ND; i++)
+      {
+         for (int k = 0; k <= i; k++)
+         {
+            double s = 0.0;
+            for (int q = 0; q < NQ; q++)
+            {
+               s += W[q] * R(q, e) * detJ(q, e) * B(q, i) * B(q, k);
+            }
+            M(i, k, e) = M(k, i, e) = s;
+            A(i, k, e) = s;
+         }
+      }
+      // Cholesky, L in the lower triangle of A.
+      for (int k = 0; k < ND; k++)
+      {
+         double d = A(k, k, e);
+         for (int l = 0; l < k; l++) { d -= A(k, l, e) * A(k, l, e); }
+         d = sqrt(d);
+         A(k, k, e) = d;
+         for (int i = k + 1; i < ND; i++)
+         {
+            double s = A(i, k, e);
+            for (int l = 0; l < k; l++) { s -= A(i, l, e) * A(k, l, e); }
+            A(i, k, e) = s / d;
+         }
+      }
+      // L^{-1}, column by column from the last one.
+      for (int k = ND - 1; k >= 0; k--)
+      {
+         const double d = A(k, k, e);
+         for (int i = ND - 1; i > k; i--)
+         {
+            double s = 0.0;
+            for (int l = k + 1; l <= i; l++) { s += A(i, l, e) * A(l, k, e); }
+            A(i, k, e) = -s / d;
+         }
+         A(k, k, e) = 1.0 / d;
+      }
+      // Me^{-1} = L^{-T} L^{-1}; row i only reads rows >= i of L^{-1}.
+      for (int i = 0; i < ND; i++)
+      {
+         for (int k = 0; k <= i; k++)
+         {
+            double s = 0.0;
+            for (int l = i; l < ND; l++) { s += A(l, i, e) * A(l, k, e); }
+            A(i, k, e) = s;
+         }
+      }
+      for (int i = 0; i < ND; i++)
+      {
+         for (int k = 0; k < i; k++) { A(k, i, e) = A(i, k, e); }
+      }
+   });
+   // Me and Me_inv are used element by element on the host.
+   HostSync::Read("energy mass Me", Me.GetMemory(), ND*ND*NE);
+   HostSync::Read("energy mass Me_inv", Me_inv.GetMemory(), ND*ND*NE);
+}
+
 // dt
+// Q1D = 0 is the simplex version, one thread loop over all NQ points.
 template<int DIM, int Q1D> static inline
 void QKernel(const int NE, const int NQ,
              const bool use_viscosity,
@@ -1967,6 +2141,7 @@ void QKernel(const int NE, const int NQ,
              const Vector &sig_quads,
              const Vector &grad_v_ext,
              const DenseTensor &Jac0inv,
+             const Vector &elem_mscale,
              Vector &dt_est, Vector &h_est,
              DenseTensor &stressJinvT, DenseTensor &tauJinvT, DenseTensor &buoyJinvT) //-4-
 {
@@ -1982,15 +2157,17 @@ void QKernel(const int NE, const int NQ,
    const auto d_sig_quads = sig_quads.Read();
    const auto d_grad_v_ext = grad_v_ext.Read();
    const auto d_Jac0inv = Read(Jac0inv.GetMemory(), Jac0inv.TotalSize());
+   const auto d_elem_mscale = elem_mscale.Read();
    auto d_dt_est = dt_est.ReadWrite();
    auto d_h_est = h_est.ReadWrite();
    auto d_stressJinvT = Write(stressJinvT.GetMemory(), stressJinvT.TotalSize());
    auto d_tauJinvT = Write(tauJinvT.GetMemory(), tauJinvT.TotalSize());
    auto d_buoyJinvT = Write(buoyJinvT.GetMemory(), buoyJinvT.TotalSize());
    // auto d_tauJinvT = tauJinvT.ReadWrite();
+   const int QX = Q1D ? Q1D : NQ, QY = Q1D ? Q1D : 1, QZ = Q1D ? Q1D : 1;
    if (DIM == 2)
    {
-      MFEM_FORALL_2D(e, NE, Q1D, Q1D, 1,
+      MFEM_FORALL_2D(e, NE, QX, QY, 1,
       {
          double Jinv[DIM2];
          double stress[DIM2];
@@ -2010,17 +2187,17 @@ void QKernel(const int NE, const int NQ,
          double Jpi[DIM2];
          double ph_dir[DIM];
          double stressJiT[DIM2];
-         MFEM_FOREACH_THREAD(qx,x,Q1D)
+         MFEM_FOREACH_THREAD(qx,x,QX)
          {
-            MFEM_FOREACH_THREAD(qy,y,Q1D)
+            MFEM_FOREACH_THREAD(qy,y,QY)
             {
-               QUpdateBody<DIM>(NE, e, NQ, qx + qy * Q1D,
+               QUpdateBody<DIM>(NE, e, NQ, qx + qy * QX,
                                 use_viscosity, use_vorticity, h0, h1order, cfl, infinity, max_vel_q, mscale_q, gravity_q,
                                 Jinv, stress, tau0, tau1, tau2, tau0_Jit, tau1_Jit, tau2_Jit,
                                 sgrad_v, spin, eig_val_data, eig_vec_data, sig_val_data, sig_vec_data,
                                 compr_dir, Jpi, ph_dir, stressJiT,
                                 d_gamma, d_lambda, d_mu, d_weights, d_Jacobians, d_rho0DetJ0w,
-                                d_e_quads, d_sig_quads, d_grad_v_ext, d_Jac0inv,
+                                d_e_quads, d_sig_quads, d_grad_v_ext, d_Jac0inv, d_elem_mscale,
                                 d_dt_est,  d_h_est, d_stressJinvT, d_tauJinvT, d_buoyJinvT); //-5a-
             }
          }
@@ -2029,7 +2206,7 @@ void QKernel(const int NE, const int NQ,
    }
    if (DIM == 3)
    {
-      MFEM_FORALL_3D(e, NE, Q1D, Q1D, Q1D,
+      MFEM_FORALL_3D(e, NE, QX, QY, QZ,
       {
          double Jinv[DIM2];
          double stress[DIM2];
@@ -2049,19 +2226,19 @@ void QKernel(const int NE, const int NQ,
          double Jpi[DIM2];
          double ph_dir[DIM];
          double stressJiT[DIM2];
-         MFEM_FOREACH_THREAD(qx,x,Q1D)
+         MFEM_FOREACH_THREAD(qx,x,QX)
          {
-            MFEM_FOREACH_THREAD(qy,y,Q1D)
+            MFEM_FOREACH_THREAD(qy,y,QY)
             {
-               MFEM_FOREACH_THREAD(qz,z,Q1D)
+               MFEM_FOREACH_THREAD(qz,z,QZ)
                {
-                  QUpdateBody<DIM>(NE, e, NQ, qx + Q1D * (qy + qz * Q1D),
+                  QUpdateBody<DIM>(NE, e, NQ, qx + QX * (qy + qz * QY),
                                    use_viscosity, use_vorticity, h0, h1order, cfl, infinity, max_vel_q, mscale_q, gravity_q,
                                    Jinv, stress, tau0, tau1, tau2, tau0_Jit, tau1_Jit, tau2_Jit,
                                    sgrad_v, spin, eig_val_data, eig_vec_data, sig_val_data, sig_vec_data,
                                    compr_dir, Jpi, ph_dir, stressJiT,
                                    d_gamma, d_lambda, d_mu, d_weights, d_Jacobians, d_rho0DetJ0w,
-                                   d_e_quads, d_sig_quads, d_grad_v_ext, d_Jac0inv,
+                                   d_e_quads, d_sig_quads, d_grad_v_ext, d_Jac0inv, d_elem_mscale,
                                    d_dt_est, d_h_est, d_stressJinvT, d_tauJinvT, d_buoyJinvT); //-5b-
                }
             }
@@ -2097,22 +2274,16 @@ void QUpdate::UpdateQuadratureData(const Vector &S, QuadratureData &qdata)
    q_dt_est = qdata.dt_est;
    q_h_est = qdata.h_est;
 
-   Vector vel_mag(H1.GetVSize()/dim);
-   for (int i = 0; i < H1.GetVSize()/dim; i++)
-   {
-      if(dim == 2){vel_mag[i] = sqrt(pow(v[i], 2) + pow(v[i+H1.GetVSize()/dim], 2));}
-      else{vel_mag[i] = sqrt(pow(v[i], 2) + pow(v[i+H1.GetVSize()/dim], 2) + pow(v[i+2*H1.GetVSize()/dim], 2));}
-   }
-
    double cut_off_vel   = 1.0/86400.0/365.25/1000.0/100.0; // 0.01 mm/yr
-   double local_max_vel = std::max(cut_off_vel, vel_mag.Max());
+   double local_max_vel = std::max(cut_off_vel, MaxVelocityMagnitude(v, dim));
    double global_max_vel;
-   MPI_Reduce(&local_max_vel, &global_max_vel, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+   MPI_Reduce(&local_max_vel, &global_max_vel, 1, MPI_DOUBLE, MPI_MAX, 0, H1.GetComm());
    // Broadcast the global_max from process 0 to all other processes
-   MPI_Bcast(&global_max_vel, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);   
+   MPI_Bcast(&global_max_vel, 1, MPI_DOUBLE, 0, H1.GetComm());   
    double max_vel_q = fmax(qdata.vbc_max_val, global_max_vel);
 
-   const int id = (dim << 4) | Q1D;
+   // Simplices use the Q1D = 0 kernels, outside of the tensor table.
+   const int id = TensorMesh(*H1.GetMesh()) ? (dim << 4) | Q1D : dim << 8;
    typedef void (*fQKernel)(const int NE, const int NQ,
                             const bool use_viscosity,
                             const bool use_vorticity,
@@ -2125,6 +2296,7 @@ void QUpdate::UpdateQuadratureData(const Vector &S, QuadratureData &qdata)
                             const Vector &Jacobians, const Vector &rho0DetJ0w,
                             const Vector &e_quads, const Vector &sig_quads, const Vector &grad_v_ext,
                             const DenseTensor &Jac0inv,
+                            const Vector &elem_mscale,
                             Vector &dt_est, Vector &h_est, 
                             DenseTensor &stressJinvT, DenseTensor &tauJinvT, DenseTensor &buoyJinvT); // -2-
    static std::unordered_map<int, fQKernel> qupdate =
@@ -2135,7 +2307,9 @@ void QUpdate::UpdateQuadratureData(const Vector &S, QuadratureData &qdata)
       {0x2C,&QKernel<2,12>},{0x2E,&QKernel<2,14>},
       {0x30,&QKernel<2,16>},
       // 3D.
-      {0x34,&QKernel<3,4>}, {0x36,&QKernel<3,6>}, {0x38,&QKernel<3,8>}
+      {0x34,&QKernel<3,4>}, {0x36,&QKernel<3,6>}, {0x38,&QKernel<3,8>},
+      // Simplices.
+      {0x200,&QKernel<2,0>}, {0x300,&QKernel<3,0>}
    };
    if (!qupdate[id])
    {
@@ -2146,20 +2320,31 @@ void QUpdate::UpdateQuadratureData(const Vector &S, QuadratureData &qdata)
    qupdate[id](NE, NQ, use_viscosity, use_vorticity, qdata.h0, h1order, 
                cfl, infinity, qdata.vbc_max_val, qdata.mscale, qdata.gravity, gamma_gf, lambda_gf, mu_gf, ir.GetWeights(), q_dx,
                // dt, cfl, infinity, qdata.vbc_max_val, qdata.mscale, qdata.gravity, gamma_gf, lambda_gf, mu_gf, ir.GetWeights(), q_dx,
-               qdata.rho0DetJ0w, q_e, q_sig, q_dv, qdata.Jac0inv, q_dt_est, q_h_est, qdata.stressJinvT, qdata.tauJinvT, qdata.buoyJinvT); // -3-
+               qdata.rho0DetJ0w, q_e, q_sig, q_dv, qdata.Jac0inv, qdata.elem_mscale, q_dt_est, q_h_est, qdata.stressJinvT, qdata.tauJinvT, qdata.buoyJinvT); // -3-
    qdata.dt_est = q_dt_est.Min();
    qdata.h_est = q_h_est.Min();
    timer->sw_qdata.Stop();
+   timer->Wait(timer->sw_wait_qdata);
    timer->quad_tstep += NE;
 }
 
 void LagrangianGeoOperator::AssembleForceMatrix() const
 {
    if (forcemat_is_assembled || p_assembly) { return; }
+   if (ForceEA)
+   {
+      timer.sw_force.Start();
+      ForceEA->Assemble();
+      timer.sw_force.Stop();
+      timer.Wait(timer.sw_wait_force);
+      forcemat_is_assembled = true;
+      return;
+   }
    Force = 0.0;
    timer.sw_force.Start();
    Force.Assemble();
    timer.sw_force.Stop();
+   timer.Wait(timer.sw_wait_force);
    forcemat_is_assembled = true;
 }
 
@@ -2257,56 +2442,47 @@ void LagrangianGeoOperator::TMOPUpdate(const Vector &S, bool quick)
    
    // Element number update
    NE = pmesh->GetNE();
-   const int NQ = ir.GetNPoints();
 
    if (quick) { return; }
-   
-   // update mass matrix
-   Mv.Update();
-   Mv.Assemble();
-   Mv_spmat_copy = Mv.SpMat();
 
-   // update mass matrix
-   fic_Mv.Update();
-   fic_Mv.Assemble();
-   fic_Mv_spmat_copy = Mv.SpMat();
+   // The cached geometric factors belong to the previous mesh.
+   pmesh->DeleteGeometricFactors();
+   // The mass scaling factors are fixed between remeshings; only a change of
+   // the element count forces new ones.
+   if (qdata.elem_mscale.Size() != NE) { ComputeMassScaling(); }
 
+   if (p_assembly)
    {
-      // Me.SetSize(l2dofs_cnt, l2dofs_cnt, NE);
-      // Me_inv.SetSize(l2dofs_cnt, l2dofs_cnt, NE);
-      MassIntegrator mi(rho0_coeff, &ir);
-      // MassIntegrator mi(scale_rho0_coeff, &ir);
-      for (int e = 0; e < NE; e++)
+      // Rebuild only when the elements changed (h-refinement, rebalance) or
+      // selective mass scaling was switched, which adds VMassPA_rho.
+      if (NE != pa_ne || pmesh->GetSequence() != pa_sequence ||
+          selective_mscale != (VMassPA_rho != nullptr))
       {
-         DenseMatrixInverse inv(&Me(e));
-         const FiniteElement &fe = *L2.GetFE(e);
-         ElementTransformation &Tr = *L2.GetElementTransformation(e);
-         mi.AssembleElementMatrix(fe, Tr, Me(e));
-         inv.Factor();
-         inv.GetInverseMatrix(Me_inv(e));
+         SetupPAOperators();
       }
+      else { UpdatePAOperators(); }
    }
-
-   // update 'rho0DetJ0' and 'Jac0inv' at all quadrature points
-   // TODO: remove code duplication
-   Vector rho_vals(NQ);
-   for (int i = 0; i < NE; i++)
+   else
    {
-      rho0_gf.GetValues(i, ir, rho_vals);
-      ElementTransformation *T = H1.GetElementTransformation(i);
-      for (int q = 0; q < NQ; q++)
-      {
-         const IntegrationPoint &ip = ir.IntPoint(q);
-         T->SetIntPoint(&ip);
-
-         DenseMatrixInverse Jinv(T->Jacobian());
-         Jinv.GetInverseMatrix(qdata.Jac0inv(i*NQ + q));
+      // update mass matrix
+      Mv.Update();
+      Mv.Assemble();
+      Mv_spmat_copy = Mv.SpMat();
 
-         const double rho0DetJ0 = T->Weight() * rho_vals(q);
-         qdata.rho0DetJ0w(i*NQ + q) = rho0DetJ0 *
-                                           ir.IntPoint(q).weight;
-      }
+      // update mass matrix
+      fic_Mv.Update();
+      fic_Mv.Assemble();
+      fic_Mv_spmat_copy = Mv.SpMat();
+      FormVelocitySystem();
    }
+
+   // Me.SetSize(l2dofs_cnt, l2dofs_cnt, NE);
+   // Me_inv.SetSize(l2dofs_cnt, l2dofs_cnt, NE);
+   EnergyMassInverse(NE, ir, pmesh, L2, rho0_gf, Me, Me_inv);
+
+   // update 'rho0DetJ0' and 'Jac0inv' at all quadrature points
+   double vol;
+   Rho0DetJ0Vol(dim, NE, ir, pmesh, L2, rho0_gf, qdata, vol);
 }
 
 
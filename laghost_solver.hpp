@@ -51,8 +51,24 @@ struct TimingData
    HYPRE_Int H1iter, L2iter;
    HYPRE_Int quad_tstep;
 
+   // Time spent in a barrier at the end of each phase, waiting for the other
+   // ranks. MPI time inside the phase (CG reductions, halo exchanges) stays
+   // in the phase time. Only measured when wait_comm is set, since the
+   // barrier adds synchronization.
+   StopWatch sw_wait_cg, sw_wait_force, sw_wait_qdata;
+   MPI_Comm wait_comm;
+
    TimingData(const HYPRE_Int l2d) :
-      L2dof(l2d), H1iter(0), L2iter(0), quad_tstep(0) { }
+      L2dof(l2d), H1iter(0), L2iter(0), quad_tstep(0),
+      wait_comm(MPI_COMM_NULL) { }
+
+   void Wait(StopWatch &sw)
+   {
+      if (wait_comm == MPI_COMM_NULL) { return; }
+      sw.Start();
+      MPI_Barrier(wait_comm);
+      sw.Stop();
+   }
 };
 
 class QUpdate
@@ -133,6 +149,18 @@ public:
    // void UpdateQuadratureData(const Vector &S, QuadratureData &qdata, const double dt);
 };
 
+// Coefficient scaled by a factor per element, s(e) * c.
+class ElementScaledCoefficient : public Coefficient
+{
+private:
+   Coefficient &c;
+   const Vector &s;
+public:
+   ElementScaledCoefficient(Coefficient &c, const Vector &s) : c(c), s(s) { }
+   virtual double Eval(ElementTransformation &T, const IntegrationPoint &ip)
+   { return s(T.ElementNo) * c.Eval(T, ip); }
+};
+
 // Given a solutions state (x, v, e), this class performs all necessary
 // computations to evaluate the new slopes (dx_dt, dv_dt, de_dt).
 class LagrangianGeoOperator : public TimeDependentOperator
@@ -171,6 +199,9 @@ protected:
    const bool use_viscosity, use_vorticity, p_assembly, winkler_foundation, dyn_damping;
    const double cg_rel_tol;
    mutable double mass_scale, grav_mag, thickness, winkler_rho, dyn_factor, vbc_max_val;
+   // Selective mass scaling, see SetSelectiveMassScaling().
+   bool selective_mscale;
+   double smscale_h, smscale_max_added;
    const int cg_max_iter;
    const double ftz_tol;
    ParGridFunction &gamma_gf;
@@ -184,6 +215,12 @@ protected:
    mutable SparseMatrix Mv_spmat_copy;
    mutable ParBilinearForm fic_Mv;
    mutable SparseMatrix fic_Mv_spmat_copy;
+   // Full assembly: the eliminated velocity system with its Chebyshev
+   // preconditioner and CG solver. Formed whenever fic_Mv is assembled and
+   // reused by all SolveVelocity() stages until the next reassembly.
+   mutable HypreParMatrix Mv_A;
+   mutable HypreSmoother Mv_prec;
+   mutable CGSolver Mv_cg;
 
    mutable DenseTensor Me, Me_inv;
 
@@ -198,6 +235,8 @@ protected:
    // These values are recomputed at each time step.
    const int Q1D;
    mutable QuadratureData qdata;
+   // Velocity mass densities with the selective mass scaling factors.
+   ElementScaledCoefficient ms_rho0_coeff, ms_scale_rho0_coeff;
    mutable bool qdata_is_current, forcemat_is_assembled;
    mutable bool gmat_is_assembled;
    // Force matrix that combines the kinematic and thermodynamic spaces. It is
@@ -210,11 +249,19 @@ protected:
    // mutable LinearForm *Body_Force;
    // Same as above, but done through partial assembly.
    ForcePAOperator *ForcePA;
+   // Full assembly alternative to the sparse Force matrix.
+   ForceEAOperator *ForceEA;
    StressPAOperator *StressPA; // partial assembly for stress rate, slee
    // Mass matrices done through partial assembly:
    // velocity (coupled H1 assembly) and energy (local L2 assemblies).
    MassPAOperator *VMassPA, *EMassPA;
+   // Unscaled velocity mass for the gravity load, only with selective mass
+   // scaling (VMassPA otherwise).
+   MassPAOperator *VMassPA_rho;
    OperatorJacobiSmoother *VMassPA_Jprec;
+   // Mesh elements and sequence the PA operators were built for.
+   int pa_ne;
+   long pa_sequence;
    // Linear solver for energy.
    CGSolver CG_VMass, CG_EMass;
 
@@ -242,6 +289,13 @@ protected:
       }
    }
 
+   // (Re)builds the partial assembly operators, QUpdate and the velocity
+   // mass CG solver for the current mesh.
+   void SetupPAOperators();
+   // Refreshes the PA mass data and its preconditioner after the mesh nodes
+   // moved, keeping the operators when the elements are the same.
+   void UpdatePAOperators();
+
    void UpdateQuadratureData(const Vector &S) const;
    // void UpdateQuadratureData(const Vector &S, const double dt) const;
    void AssembleForceMatrix() const;
@@ -264,7 +318,8 @@ public:
                            const double cgt, const int cgiter, double ftz_tol,
                            const int order_q,
                            ParGridFunction &lambda_gf, ParGridFunction &mu_gf, double mscale, const double gravity, const double _thickness,
-                           const bool winkler, const double _winkler_rho, const bool dyn_damping, const double _dyn_factor, Vector _bc_id_pa, const double _vbc_max_val);
+                           const bool winkler, const double _winkler_rho, const bool dyn_damping, const double _dyn_factor, Vector _bc_id_pa, const double _vbc_max_val,
+                           const bool force_ea);
    ~LagrangianGeoOperator();
 
 
@@ -286,19 +341,49 @@ public:
    // void RadialReturn(const Vector &S, Vector &dS_dt, const double dt) const;
    void UpdateMesh(const Vector &S) const;
    // void test_function(const Vector &S, Vector &_test) const;
-   void Getdamping(const Vector &S, Vector &_v_damping) const;
-   void Getdamping_comp(const Vector &S, const int &comp, Vector &_v_damping) const;
+   void GetVelocityTrueDofs(const Vector &S, Vector &vt) const;
    void Winkler(const Vector &S, Vector &_winkler, double &_thickness) const;
    
    // Calls UpdateQuadratureData to compute the new qdata.dt_estimate.
    // double GetTimeStepEstimate(const Vector &S) const;
    double GetTimeStepEstimate(const Vector &S) const;
    double GetLengthEstimate(const Vector &S) const;
+   // Both estimates above with a single quadrature update and reduction.
+   void GetStepEstimates(const Vector &S, double &dt_est, double &h_est) const;
    // double GetTimeStepEstimate(const Vector &S, const double dt) const;
    // double GetLengthEstimate(const Vector &S, const double dt) const;
    // double GetTimeStepEstimate(const Vector &S, const double dt, bool IamRoot) const;
    void ResetTimeStepEstimate() const;
    void ResetQuadratureData() const { qdata_is_current = false; }
+   // New mass scaling, gravity and boundary control values between runs on
+   // the same mesh; the mass matrices follow with TMOPUpdate().
+   void SetControls(const double mscale, const double gravity,
+                    const double thickness_, const double winkler_rho_,
+                    const double dyn_factor_, const double vbc_max_val_)
+   {
+      mass_scale = mscale; grav_mag = gravity; thickness = thickness_;
+      winkler_rho = winkler_rho_; dyn_factor = dyn_factor_;
+      vbc_max_val = vbc_max_val_;
+      qdata.mscale = mscale; qdata.gravity = gravity;
+      qdata.vbc_max_val = vbc_max_val_;
+   }
+   // Selective mass scaling: the inertia of each element smaller than
+   // h_target (0 = mean element size) is scaled by (h_target/h)^2, so that
+   // its stable time step becomes the one of an element of size h_target.
+   // If the added mass exceeds max_added times the total mass, h_target is
+   // lowered until it does not. The factors are computed here for the
+   // current mesh and kept fixed, so that element masses do not change from
+   // step to step; the mass operators use them after the next TMOPUpdate().
+   void SetSelectiveMassScaling(const bool on, const double h_target,
+                                const double max_added)
+   {
+      selective_mscale = on; smscale_h = h_target;
+      smscale_max_added = max_added;
+      ComputeMassScaling();
+   }
+   // Fills qdata.elem_mscale for the current mesh. Called by the setter above
+   // and after remeshing.
+   void ComputeMassScaling();
 
    // The density values, which are stored only at some quadrature points,
    // are projected as a ParGridFunction.
@@ -325,6 +410,18 @@ public:
    Vector& GetZoneVGrad() { return zone_vgrad; }
 
    void PrintTimingData(bool IamRoot, int steps, const bool fom) const;
+
+   // Full assembly: forms Mv_A from fic_Mv and sets up Mv_prec and Mv_cg.
+   void FormVelocitySystem() const;
+
+   // Measure the per-phase MPI wait of this rank (see TimingData::Wait).
+   void SetWaitProfiling(bool enable)
+   { timer.wait_comm = enable ? H1.GetComm() : MPI_COMM_NULL; }
+   TimingData &GetTimingData() const { return timer; }
+
+   // Bytes held in quadrature point data and in assembled (FA) matrices,
+   // including the local energy mass matrices and their inverses.
+   void GetMemoryUsage(long &qdata_bytes, long &matrix_bytes) const;
 };
 
 // TaylorCoefficient used in the 2D Taylor-Green problem.
@@ -11,11 +11,106 @@ using std::endl;
 
 namespace mfem
 {
+   // Target element volumes concentrating resolution in shear zones. The
+   // distance to the regions where pls_gf exceeds pls_threshold comes from
+   // the heat method; the volume grows smoothly from 1 there to size_ratio at
+   // distances beyond width, and is scaled so that the volumes add up to the
+   // mesh volume with the current number of elements. Uniform without any
+   // shear zone.
+   static void ShearZoneTargetSize(const ParGridFunction &pls_gf,
+                                   const double pls_threshold, double width,
+                                   const double size_ratio, const int myid,
+                                   ParGridFunction &size)
+   {
+      ParFiniteElementSpace &fes = *size.ParFESpace();
+      ParMesh &pmesh = *fes.GetParMesh();
+      MFEM_VERIFY(pls_gf.FESpace()->GetNE() == pmesh.GetNE(),
+                  "Plastic strain and TMOP meshes differ.");
+      MFEM_VERIFY(size_ratio >= 1.0, "tmop.shear_size_ratio must be >= 1.");
+
+      // Shear zone indicator, 1 where the plastic strain is above the
+      // threshold. Both meshes share the element numbering.
+      ParGridFunction ind(&fes);
+      GridFunctionCoefficient pls_coeff(&pls_gf);
+      ind.ProjectDiscCoefficient(pls_coeff, GridFunction::ARITHMETIC);
+      double ind_max = 0.0;
+      for (int i = 0; i < ind.Size(); i++)
+      {
+         ind(i) = (ind(i) >= pls_threshold) ? 1.0 : 0.0;
+         ind_max = std::max(ind_max, ind(i));
+      }
+      double ind_max_all;
+      MPI_Allreduce(&ind_max, &ind_max_all, 1, MPI_DOUBLE, MPI_MAX,
+                    pmesh.GetComm());
+
+      const double dx = common::AvgElementSize(pmesh);
+      if (width <= 0.0) { width = 4.0 * dx; }
+
+      if (ind_max_all > 0.0)
+      {
+         ParGridFunction dist(&fes);
+         common::HeatDistanceSolver dist_solver(2.0 * dx * dx);
+         dist_solver.smooth_steps = 1;
+         dist_solver.transform = false;
+         GridFunctionCoefficient ind_coeff(&ind);
+         dist_solver.ComputeScalarDistance(ind_coeff, dist);
+
+         // The heat method measures from the ridge of a wide band, so the
+         // band itself is set to the small size explicitly.
+         for (int i = 0; i < size.Size(); i++)
+         {
+            const double s = (ind(i) > 0.0) ? 0.0 :
+                             std::min(std::max(dist(i) / width, 0.0), 1.0);
+            size(i) = 1.0 + (size_ratio - 1.0) * s * s * (3.0 - 2.0 * s);
+         }
+         DiffuseField(size, 2);
+      }
+      else
+      {
+         size = 1.0;
+         if (myid == 0)
+         {
+            cout << "No plastic strain above " << pls_threshold
+                 << ", uniform target size." << endl;
+         }
+      }
+
+      // Scale by the number of elements the shape asks for, the integral of
+      // 1/size, so that the element count stays the same.
+      Vector vals;
+      double volume = 0.0, count = 0.0;
+      for (int i = 0; i < pmesh.GetNE(); i++)
+      {
+         ElementTransformation *Tr = pmesh.GetElementTransformation(i);
+         const IntegrationRule &ir =
+            IntRules.Get(pmesh.GetElementBaseGeometry(i), Tr->OrderJ());
+         size.GetValues(i, ir, vals);
+         for (int j = 0; j < ir.GetNPoints(); j++)
+         {
+            const IntegrationPoint &ip = ir.IntPoint(j);
+            Tr->SetIntPoint(&ip);
+            volume += ip.weight * Tr->Weight();
+            count  += ip.weight * Tr->Weight() / vals(j);
+         }
+      }
+      double loc[2] = { volume, count }, glob[2];
+      MPI_Allreduce(loc, glob, 2, MPI_DOUBLE, MPI_SUM, pmesh.GetComm());
+      size *= glob[1] / pmesh.GetGlobalNE();
+
+      if (myid == 0)
+      {
+         const double small = glob[1] / pmesh.GetGlobalNE();
+         cout << "Shear zone target size: " << small << " inside, "
+              << size_ratio * small << " beyond " << width
+              << " (mean " << glob[0] / pmesh.GetGlobalNE() << ")" << endl;
+      }
+   }
+
    void HR_adaptivity(ParMesh *pmesh, ParGridFunction &x_gf, const Array<int> &ess_tdofs, const int &myid, int &mesh_poly_deg, int &rs_levels, int &rp_levels, double &jitter, int &metric_id, int &target_id,\
    double &lim_const, double &adapt_lim_const, int &quad_type, int &quad_order, int &solver_type, int &solver_iter, double &solver_rtol, \
    int &solver_art_type, int &lin_solver, int &max_lin_iter, bool &move_bnd, int &combomet, bool &bal_expl_combo, bool &hradaptivity, int &h_metric_id, bool &normalization, int &verbosity_level, \
    bool &fdscheme, int &adapt_eval, bool &exactaction, bool &pa, int &n_hr_iter, int &n_h_iter, int &mesh_node_ordering, int &barrier_type, \
-   int &worst_case_type) 
+   int &worst_case_type, const ParGridFunction *pls_gf, double &shear_pls, double &shear_width, double &shear_size_ratio) 
 
 
    {
@@ -74,7 +169,7 @@ namespace mfem
       vol_loc += pmesh->GetElementVolume(i);
    }
    double vol_glb;
-   MPI_Allreduce(&vol_loc, &vol_glb, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+   MPI_Allreduce(&vol_loc, &vol_glb, 1, MPI_DOUBLE, MPI_SUM, pmesh->GetComm());
    const double small_phys_size = pow(vol_glb, 1.0 / dim) / 100.0;
 
    // 9. Add a random perturbation to the nodes in the interior of the domain.
@@ -337,7 +432,7 @@ namespace mfem
          }
          const double max = size.Max();
          double max_all;
-         MPI_Allreduce(&max, &max_all, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+         MPI_Allreduce(&max, &max_all, 1, MPI_DOUBLE, MPI_MAX, pmesh->GetComm());
 
          for (int i = 0; i < d_x.Size(); i++)
          {
@@ -375,9 +470,9 @@ namespace mfem
             }
          }
          double volume_all, volume_ind_all;
-         MPI_Allreduce(&volume, &volume_all, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+         MPI_Allreduce(&volume, &volume_all, 1, MPI_DOUBLE, MPI_SUM, pmesh->GetComm());
          MPI_Allreduce(&volume_ind, &volume_ind_all, 1, MPI_DOUBLE, MPI_SUM,
-                       MPI_COMM_WORLD);
+                       pmesh->GetComm());
          const int NE_ALL = pmesh->GetGlobalNE();
 
          const double avg_zone_size = volume_all / NE_ALL;
@@ -453,6 +548,29 @@ namespace mfem
          target_c = tc;
          break;
       }
+      case 12: // Discrete size refined around shear zones
+      {
+         MFEM_VERIFY(pls_gf, "target_id 12 needs the plastic strain field.");
+         target_t = TargetConstructor::IDEAL_SHAPE_GIVEN_SIZE;
+         DiscreteAdaptTC *tc = new DiscreteAdaptTC(target_t);
+         if (adapt_eval == 0)
+         {
+            tc->SetAdaptivityEvaluator(new AdvectorCG(al));
+         }
+         else
+         {
+#ifdef MFEM_USE_GSLIB
+            tc->SetAdaptivityEvaluator(new InterpolatorFP);
+#else
+            MFEM_ABORT("MFEM is not built with GSLIB.");
+#endif
+         }
+         ShearZoneTargetSize(*pls_gf, shear_pls, shear_width, shear_size_ratio,
+                             myid, size);
+         tc->SetParDiscreteTargetSize(size);
+         target_c = tc;
+         break;
+      }
       // Targets used for hr-adaptivity tests.
       case 9:  // size target in an annular region.
       case 10: // size+aspect-ratio in an annular region.
@@ -470,7 +588,7 @@ namespace mfem
    }
    if (target_c == NULL)
    {
-      target_c = new TargetConstructor(target_t, MPI_COMM_WORLD);
+      target_c = new TargetConstructor(target_t, pmesh->GetComm());
    }
    target_c->SetNodes(x0);
 
@@ -604,7 +722,7 @@ namespace mfem
       if (combomet == 1)
       {
          target_c2 = new TargetConstructor(
-            TargetConstructor::IDEAL_SHAPE_EQUAL_SIZE, MPI_COMM_WORLD);
+            TargetConstructor::IDEAL_SHAPE_EQUAL_SIZE, pmesh->GetComm());
          target_c2->SetVolumeScale(0.01);
          target_c2->SetNodes(x0);
          tmop_integ2 = new TMOP_Integrator(metric2, target_c2, h_metric);
@@ -646,7 +764,7 @@ namespace mfem
       }
    }
    double minJ0;
-   MPI_Allreduce(&min_detJ, &minJ0, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+   MPI_Allreduce(&min_detJ, &minJ0, 1, MPI_DOUBLE, MPI_MIN, pmesh->GetComm());
    min_detJ = minJ0;
    if (myid == 0)
    { cout << "Minimum det(J) of the original mesh is " << min_detJ << endl; }
@@ -671,7 +789,7 @@ namespace mfem
       min_detJ /= Wideal.Det();
 
       double h0min = h0.Min(), h0min_all;
-      MPI_Allreduce(&h0min, &h0min_all, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+      MPI_Allreduce(&h0min, &h0min_all, 1, MPI_DOUBLE, MPI_MIN, pmesh->GetComm());
       // Slightly below minJ0 to avoid div by 0.
       min_detJ -= 0.01 * h0min_all;
    }   
@@ -866,7 +984,7 @@ namespace mfem
    }
    else if (lin_solver == 1)
    {
-      CGSolver *cg = new CGSolver(MPI_COMM_WORLD);
+      CGSolver *cg = new CGSolver(pmesh->GetComm());
       cg->SetMaxIter(max_lin_iter);
       cg->SetRelTol(linsol_rtol);
       cg->SetAbsTol(0.0);
@@ -875,7 +993,7 @@ namespace mfem
    }
    else
    {
-      MINRESSolver *minres = new MINRESSolver(MPI_COMM_WORLD);
+      MINRESSolver *minres = new MINRESSolver(pmesh->GetComm());
       minres->SetMaxIter(max_lin_iter);
       minres->SetRelTol(linsol_rtol);
       minres->SetAbsTol(0.0);
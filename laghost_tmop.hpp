@@ -11,6 +11,6 @@ namespace mfem
    double &, double &, int &, int &, int &, int &, double &, \
    int &, int &, int &, bool &, int &, bool &, bool &, int &, bool &, int &, \
    bool &, int &, bool &, bool &, int &, int &, int &, int &, \
-   int &);
+   int &, const ParGridFunction *, double &, double &, double &);
 }
 
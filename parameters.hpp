@@ -34,6 +34,17 @@ struct Sim {
     bool        mem_usage;
     bool        fom;
     bool        gpu_aware_mpi;
+    bool        surface_output;
+    int         surface_steps;
+    bool        log_energy;
+    bool        output_float32;
+    int         output_lod;
+    std::string output_field_every;
+    bool        imbalance_report;
+    std::string imbalance_csv;
+    int         omp_threads;
+    bool        sync_report;
+    std::string ensemble;
 };
 
 struct Solver {
@@ -43,7 +54,13 @@ struct Solver {
     double ftz_tol;
     int    cg_max_iter;
     bool   p_assembly;
+    bool   force_ea;
     bool   impose_visc;
+    double dt_safety;
+    double dt_growth;
+    double dt_retry_factor;
+    int    dt_max_retries;
+    bool   dt_log;
 };
 
 struct BC {
@@ -53,6 +70,7 @@ struct BC {
     std::string bc_vxs;
     std::string bc_vys;
     std::string bc_vzs;
+    double bc_ramp_time;
 };
 
 
@@ -71,6 +89,9 @@ struct Control {
     bool   mass_bal;
     bool   dyn_damping;
     double dyn_factor;
+    bool   selective_mscale;
+    double smscale_h;
+    double smscale_max_added;
     bool   surf_proc;
     double surf_diff;
     bool   bott_proc;
@@ -163,6 +184,10 @@ struct TMOP {
     int    barrier_type;
     int    worst_case_type;
     double tmop_cond_num;
+    double shear_pls;
+    double shear_width;
+    double shear_size_ratio;
+    bool   remap_product;
 };
 
 struct Param {
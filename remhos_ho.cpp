@@ -151,7 +151,7 @@ void NeumannHOSolver::CalcHOSolution(const Vector &u, Vector &du) const
 
       double resid_loc = res.Norml2(); resid_loc *= resid_loc;
       double resid;
-      MPI_Allreduce(&resid_loc, &resid, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+      MPI_Allreduce(&resid_loc, &resid, 1, MPI_DOUBLE, MPI_SUM, pfes.GetComm());
       resid = std::sqrt(resid);
       if (resid <= abs_tol) { return; }
 
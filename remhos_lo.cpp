@@ -41,6 +41,15 @@ DiscreteUpwind::DiscreteUpwind(ParFiniteElementSpace &space,
 }
 
 void DiscreteUpwind::CalcLOSolution(const Vector &u, Vector &du) const
+{
+   ParGridFunction u_gf(&pfes);
+   u_gf = u;
+   u_gf.ExchangeFaceNbrData();
+   CalcLOSolution(u, u_gf.FaceNbrData(), du);
+}
+
+void DiscreteUpwind::CalcLOSolution(const Vector &u, const Vector &u_nd,
+                                    Vector &du) const
 {
    const int ndof = pfes.GetFE(0)->GetDof();
    Vector alpha(ndof); alpha = 0.0;
@@ -52,10 +61,7 @@ void DiscreteUpwind::CalcLOSolution(const Vector &u, Vector &du) const
    D.Mult(u, du);
 
    // Lump fluxes (for PDU).
-   ParGridFunction u_gf(&pfes);
-   u_gf = u;
-   u_gf.ExchangeFaceNbrData();
-   Vector &u_nd = u_gf.FaceNbrData();
+   u_nd.HostRead();
    const int ne = pfes.GetNE();
    u.HostRead();
    du.HostReadWrite();
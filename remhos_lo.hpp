@@ -37,6 +37,12 @@ public:
    virtual void UpdateTimeStep(double dt_new) { dt = dt_new; }
 
    virtual void CalcLOSolution(const Vector &u, Vector &du) const = 0;
+
+   // Same as above, but u_nd holds the face-neighbor values of u that were
+   // already exchanged by the caller. Solvers that don't use them ignore u_nd.
+   virtual void CalcLOSolution(const Vector &u, const Vector &u_nd,
+                               Vector &du) const
+   { CalcLOSolution(u, du); }
 };
 
 class Assembly;
@@ -59,6 +65,8 @@ public:
                   Assembly &asmbly, bool updateD);
 
    virtual void CalcLOSolution(const Vector &u, Vector &du) const;
+   virtual void CalcLOSolution(const Vector &u, const Vector &u_nd,
+                               Vector &du) const;
 };
 
 class ResidualDistribution : public LOSolver
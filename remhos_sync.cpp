@@ -114,7 +114,7 @@ void ZeroOutEmptyDofs(const Array<bool> &ind_elem,
 }
 
 void ComputeMinMaxS(int NE, const Vector &us, const Vector &u,
-                    double &s_min_glob, double &s_max_glob)
+                    double &s_min_glob, double &s_max_glob, MPI_Comm comm)
 {
    const int size = u.Size();
    Vector s(size);
@@ -132,11 +132,12 @@ void ComputeMinMaxS(int NE, const Vector &us, const Vector &u,
       min_s = min(s(i), min_s);
       max_s = max(s(i), max_s);
    }
-   MPI_Allreduce(&min_s, &s_min_glob, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
-   MPI_Allreduce(&max_s, &s_max_glob, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+   MPI_Allreduce(&min_s, &s_min_glob, 1, MPI_DOUBLE, MPI_MIN, comm);
+   MPI_Allreduce(&max_s, &s_max_glob, 1, MPI_DOUBLE, MPI_MAX, comm);
 }
 
-void ComputeMinMaxS(const Vector &s, const Array<bool> &bool_dofs, int myid)
+void ComputeMinMaxS(const Vector &s, const Array<bool> &bool_dofs, int myid,
+                    MPI_Comm comm)
 {
    s.HostRead();
    bool_dofs.HostRead();
@@ -152,8 +153,8 @@ void ComputeMinMaxS(const Vector &s, const Array<bool> &bool_dofs, int myid)
       max_s = max(s(i), max_s);
    }
    double min_s_glob, max_s_glob;
-   MPI_Allreduce(&min_s, &min_s_glob, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
-   MPI_Allreduce(&max_s, &max_s_glob, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+   MPI_Allreduce(&min_s, &min_s_glob, 1, MPI_DOUBLE, MPI_MIN, comm);
+   MPI_Allreduce(&max_s, &max_s_glob, 1, MPI_DOUBLE, MPI_MAX, comm);
 
    if (myid == 0)
    {
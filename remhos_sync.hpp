@@ -35,8 +35,9 @@ void ZeroOutEmptyDofs(const Array<bool> &ind_elem,
 
 // Set of functions that are used for debug calls.
 void ComputeMinMaxS(int NE, const Vector &us, const Vector &u,
-                    double &s_min_glob, double &s_max_glob);
-void ComputeMinMaxS(const Vector &s, const Array<bool> &bool_dofs, int myid);
+                    double &s_min_glob, double &s_max_glob, MPI_Comm comm);
+void ComputeMinMaxS(const Vector &s, const Array<bool> &bool_dofs, int myid,
+                    MPI_Comm comm);
 void PrintCellValues(int cell_id, int NE, const Vector &vec, const char *msg);
 
 // Checks if us_lo / s_lo is in the full stencil bounds.
@@ -21,6 +21,95 @@ using namespace std;
 namespace mfem
 {
 
+FaceNbrExchange::FaceNbrExchange(ParFiniteElementSpace &space, int num_fields)
+   : pfes(space), nfields(num_fields),
+     num_face_nbrs(space.GetParMesh()->GetNFaceNeighbors())
+{
+   pfes.ExchangeFaceNbrData();
+   if (num_face_nbrs == 0) { return; }
+
+   ParMesh *pmesh = pfes.GetParMesh();
+   const int *send_offset = pfes.send_face_nbr_ldof.GetI();
+   const int *recv_offset = pfes.face_nbr_ldof.GetI();
+   send_buf.SetSize(nfields * send_offset[num_face_nbrs]);
+   recv_buf.SetSize(nfields * recv_offset[num_face_nbrs]);
+   send_buf.HostWrite();
+   recv_buf.HostWrite();
+
+   // Message of neighbor fn: [field 0 | field 1 | ... ] of its dof list.
+   MPI_Comm comm = pfes.GetComm();
+   const int tag = 413;
+   requests.SetSize(2 * num_face_nbrs);
+   for (int fn = 0; fn < num_face_nbrs; fn++)
+   {
+      const int nbr_rank = pmesh->GetFaceNbrRank(fn);
+      const int s_cnt = send_offset[fn+1] - send_offset[fn];
+      const int r_cnt = recv_offset[fn+1] - recv_offset[fn];
+      MPI_Send_init(send_buf.GetData() + nfields * send_offset[fn],
+                    nfields * s_cnt, MPI_DOUBLE, nbr_rank, tag, comm,
+                    &requests[fn]);
+      MPI_Recv_init(recv_buf.GetData() + nfields * recv_offset[fn],
+                    nfields * r_cnt, MPI_DOUBLE, nbr_rank, tag, comm,
+                    &requests[num_face_nbrs + fn]);
+   }
+}
+
+FaceNbrExchange::~FaceNbrExchange()
+{
+   for (int i = 0; i < requests.Size(); i++)
+   {
+      MPI_Request_free(&requests[i]);
+   }
+}
+
+void FaceNbrExchange::Exchange(const Array<ParGridFunction *> &fields)
+{
+   MFEM_VERIFY(fields.Size() == nfields, "Wrong number of exchanged fields.");
+
+   const int nbr_size = pfes.GetFaceNbrVSize();
+   for (int k = 0; k < nfields; k++)
+   {
+      fields[k]->FaceNbrData().SetSize(nbr_size);
+   }
+   if (num_face_nbrs == 0) { return; }
+
+   const int *send_offset = pfes.send_face_nbr_ldof.GetI();
+   const int *send_ldof   = pfes.send_face_nbr_ldof.GetJ();
+   const int *recv_offset = pfes.face_nbr_ldof.GetI();
+
+   double *h_send = send_buf.HostWrite();
+   for (int fn = 0; fn < num_face_nbrs; fn++)
+   {
+      const int cnt = send_offset[fn+1] - send_offset[fn];
+      const int *ldofs = send_ldof + send_offset[fn];
+      double *buf = h_send + nfields * send_offset[fn];
+      for (int k = 0; k < nfields; k++)
+      {
+         const double *h_f = fields[k]->HostRead();
+         for (int i = 0; i < cnt; i++)
+         {
+            const int ldof = ldofs[i];
+            buf[k * cnt + i] = h_f[ldof >= 0 ? ldof : -1 - ldof];
+         }
+      }
+   }
+
+   MPI_Startall(requests.Size(), requests.GetData());
+   MPI_Waitall(requests.Size(), requests.GetData(), MPI_STATUSES_IGNORE);
+
+   const double *h_recv = recv_buf.HostRead();
+   for (int k = 0; k < nfields; k++)
+   {
+      double *h_nbr = fields[k]->FaceNbrData().HostWrite();
+      for (int fn = 0; fn < num_face_nbrs; fn++)
+      {
+         const int cnt = recv_offset[fn+1] - recv_offset[fn];
+         const double *buf = h_recv + nfields * recv_offset[fn] + k * cnt;
+         for (int i = 0; i < cnt; i++) { h_nbr[recv_offset[fn] + i] = buf[i]; }
+      }
+   }
+}
+
 SmoothnessIndicator::SmoothnessIndicator(int type_id,
                                          ParMesh &subcell_mesh,
                                          ParFiniteElementSpace &pfes_DG_,
@@ -278,7 +367,7 @@ void SmoothnessIndicator::ApproximateLaplacian(const Vector &x,
 
       double loc_res = z_tv.Norml2();
       loc_res *= loc_res;
-      MPI_Allreduce(&loc_res, &resid, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+      MPI_Allreduce(&loc_res, &resid, 1, MPI_DOUBLE, MPI_SUM, pfes_CG_sub.GetComm());
       resid = sqrt(resid);
 
       if (resid <= abs_tol) { break; }
@@ -307,7 +396,7 @@ void SmoothnessIndicator::ApproximateLaplacian(const Vector &x,
 
       double loc_res = z_tv.Norml2();
       loc_res *= loc_res;
-      MPI_Allreduce(&loc_res, &resid, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+      MPI_Allreduce(&loc_res, &resid, 1, MPI_DOUBLE, MPI_SUM, pfes_CG_sub.GetComm());
       resid = sqrt(resid);
 
       if (resid <= abs_tol) { break; }
@@ -1428,8 +1517,8 @@ void GetMinMax(const ParGridFunction &g, double &min, double &max)
 {
    g.HostRead();
    double min_loc = g.Min(), max_loc = g.Max();
-   MPI_Allreduce(&min_loc, &min, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
-   MPI_Allreduce(&max_loc, &max, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+   MPI_Allreduce(&min_loc, &min, 1, MPI_DOUBLE, MPI_MIN, g.ParFESpace()->GetComm());
+   MPI_Allreduce(&max_loc, &max, 1, MPI_DOUBLE, MPI_MAX, g.ParFESpace()->GetComm());
 }
 
 Array<int> SparseMatrix_Build_smap(const SparseMatrix &A)
@@ -44,6 +44,28 @@ void VisualizeField(socketstream &sock, const char *vishost, int visport,
                     int x, int y, int w, int h,
                     const char *keys = NULL, bool vec = false);
 
+// Batched face-neighbor exchange for several DG fields that share the same
+// ParFiniteElementSpace. All fields travel in one message per neighbor, using
+// persistent MPI requests that are set up once per mesh. On return from
+// Exchange(), FaceNbrData() of every field is filled exactly as by
+// ParGridFunction::ExchangeFaceNbrData().
+class FaceNbrExchange
+{
+private:
+   ParFiniteElementSpace &pfes;
+   const int nfields, num_face_nbrs;
+   Vector send_buf, recv_buf;
+   Array<MPI_Request> requests;
+
+public:
+   FaceNbrExchange(ParFiniteElementSpace &space, int num_fields);
+   ~FaceNbrExchange();
+
+   int NumFields() const { return nfields; }
+
+   void Exchange(const Array<ParGridFunction *> &fields);
+};
+
 class DofInfo;
 
 class SmoothnessIndicator